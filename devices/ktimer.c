@@ -0,0 +1,178 @@
+/* ktimer.c: Kernel timers on a hierarchical timer wheel. */
+
+#include "devices/ktimer.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+
+//==================================================================
+//				Project 1 - Timer Wheel
+//------------------------------------------------------------------
+
+/* 가까운 wheel은 tick 하나당 slot 하나, 256 tick 앞까지 담는다.
+   먼 wheel은 단계마다 64 slot이고, slot 하나가 아래 단계 한 바퀴를 담는다.
+   그래서 2^32 tick 앞까지는 정확한 slot에 들어가고, 더 먼 timer는
+   맨 위 단계의 마지막 slot에 두었다가 내려올 때 다시 넣는다. */
+#define NEAR_BITS 8
+#define NEAR_SIZE (1 << NEAR_BITS)
+#define NEAR_MASK (NEAR_SIZE - 1)
+#define FAR_BITS 6
+#define FAR_SIZE (1 << FAR_BITS)
+#define FAR_MASK (FAR_SIZE - 1)
+#define FAR_LEVELS 4
+
+/* LEVEL 단계 slot 하나가 담는 tick의 자리수 */
+#define FAR_SHIFT(LEVEL) (NEAR_BITS + (LEVEL) * FAR_BITS)
+
+/* wheel이 곧바로 담을 수 있는 가장 먼 거리 */
+#define WHEEL_SPAN ((int64_t) 1 << FAR_SHIFT (FAR_LEVELS))
+
+static struct list near_wheel[NEAR_SIZE];
+static struct list far_wheel[FAR_LEVELS][FAR_SIZE];
+
+/* 다음에 처리할 tick. 이보다 앞의 slot은 모두 처리했다. */
+static int64_t wheel_tick;
+
+/* 커널 timer wheel을 초기화한다. */
+void
+ktimer_init (void) {
+	for (int i = 0; i < NEAR_SIZE; i++)
+		list_init (&near_wheel[i]);
+	for (int level = 0; level < FAR_LEVELS; level++)
+		for (int i = 0; i < FAR_SIZE; i++)
+			list_init (&far_wheel[level][i]);
+	wheel_tick = 0;
+}
+
+/* T가 만료되면 FUNC(AUX)를 부르도록 초기화한다. */
+void
+ktimer_setup (struct ktimer *t, ktimer_func *func, void *aux) {
+	ASSERT (t != NULL);
+	ASSERT (func != NULL);
+
+	t->func = func;
+	t->aux = aux;
+	t->expires = 0;
+	t->pending = false;
+}
+
+/* T를 만료 tick에 맞는 slot에 넣는다. 인터럽트가 꺼진 상태여야 한다. */
+static void
+wheel_add (struct ktimer *t) {
+	int64_t expires = t->expires;
+	int64_t delta = expires - wheel_tick;
+	struct list *slot;
+
+	if (delta < 0) {
+		/* 이미 지난 시간이면 바로 다음 tick에 처리한다. */
+		slot = &near_wheel[wheel_tick & NEAR_MASK];
+	} else if (delta < NEAR_SIZE) {
+		slot = &near_wheel[expires & NEAR_MASK];
+	} else {
+		int level = 0;
+
+		if (delta >= WHEEL_SPAN) {
+			/* 너무 먼 timer는 맨 위 단계의 가장 먼 slot에 둔다.
+			   T->expires는 그대로이므로 내려올 때 다시 자리를 찾는다. */
+			expires = wheel_tick + WHEEL_SPAN - 1;
+			level = FAR_LEVELS - 1;
+		} else {
+			while (delta >= (int64_t) 1 << FAR_SHIFT (level + 1))
+				level++;
+		}
+		slot = &far_wheel[level][(expires >> FAR_SHIFT (level)) & FAR_MASK];
+	}
+	list_push_back (slot, &t->elem);
+}
+
+/* T를 EXPIRES tick에 만료되도록 건다. 이미 걸려 있으면 옮긴다.
+   EXPIRES가 지났으면 다음 tick에 만료된다. O(1)이다. */
+void
+ktimer_arm (struct ktimer *t, int64_t expires) {
+	enum intr_level old_level = intr_disable ();
+
+	if (t->pending)
+		list_remove (&t->elem);
+	t->expires = expires;
+	t->pending = true;
+	wheel_add (t);
+
+	intr_set_level (old_level);
+}
+
+/* T가 걸려 있으면 내리고 true를 반환한다.
+   이미 만료되었거나 걸려 있지 않았으면 false를 반환한다. */
+bool
+ktimer_cancel (struct ktimer *t) {
+	enum intr_level old_level = intr_disable ();
+	bool pending = t->pending;
+
+	if (pending) {
+		list_remove (&t->elem);
+		t->pending = false;
+	}
+
+	intr_set_level (old_level);
+	return pending;
+}
+
+/* LIMIT tick까지 만료될 timer가 있으면 그중 가장 이른 tick을, 없으면
+   LIMIT을 반환한다. 가까운 wheel만 보므로 먼 wheel이 내려오는 256 tick
+   경계에서는 멈춘다. 인터럽트가 꺼진 상태여야 한다. */
+int64_t
+ktimer_next (int64_t limit) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (int64_t tick = wheel_tick; tick < limit; tick++)
+		if ((tick & NEAR_MASK) == 0 || !list_empty (&near_wheel[tick & NEAR_MASK]))
+			return tick;
+	return limit;
+}
+
+/* LEVEL 단계의 INDEX slot에 있는 timer를 모두 한 단계 아래로 내린다.
+   INDEX를 반환한다. 0이면 위 단계도 한 칸 돌아야 한다. */
+static int
+cascade (int level, int index) {
+	struct list *slot = &far_wheel[level][index];
+	struct list moved;
+
+	list_init (&moved);
+	while (!list_empty (slot))
+		list_push_back (&moved, list_pop_front (slot));
+	while (!list_empty (&moved))
+		wheel_add (list_entry (list_pop_front (&moved), struct ktimer, elem));
+	return index;
+}
+
+/* NOW tick까지 만료된 timer의 콜백을 부른다. timer 인터럽트에서 부른다.
+   한 tick에 드는 일은 그 tick에 만료되는 timer 수와, 256 tick마다
+   내려오는 slot 하나의 크기에 비례한다. */
+void
+ktimer_run (int64_t now) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (wheel_tick <= now) {
+		int index = wheel_tick & NEAR_MASK;
+		struct list expired;
+
+		/* 가까운 wheel이 한 바퀴 돌았으면 먼 wheel에서 내려 온다. */
+		if (index == 0)
+			for (int level = 0; level < FAR_LEVELS; level++)
+				if (cascade (level, (wheel_tick >> FAR_SHIFT (level)) & FAR_MASK))
+					break;
+
+		/* 콜백이 다른 timer를 걸거나 내릴 수 있으므로 slot을 먼저 비운다. */
+		list_init (&expired);
+		while (!list_empty (&near_wheel[index]))
+			list_push_back (&expired, list_pop_front (&near_wheel[index]));
+		wheel_tick++;
+
+		while (!list_empty (&expired)) {
+			struct ktimer *t = list_entry (list_pop_front (&expired),
+					struct ktimer, elem);
+
+			t->pending = false;
+			t->func (t->aux);
+		}
+	}
+}
+//==================================================================
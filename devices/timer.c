@@ -3,6 +3,7 @@
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include "devices/ktimer.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/synch.h"
@@ -24,6 +25,29 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+//==================================================================
+//				Project 1 - Tickless Idle
+//------------------------------------------------------------------
+/* true idle  ֱ ͷƮ . -tickless ɼ Ҵ. */
+bool timer_tickless;
+
+/* tick ϳ شϴ 8254 count */
+static uint16_t pit_count;
+
+/* 8254 one-shot    ͷƮ  
+   tick , ֱ  0. */
+static int64_t oneshot_ticks;
+
+/* idle  ͷƮ   tick  */
+static int64_t skipped_ticks;
+
+static void pit_periodic (void);
+static void pit_oneshot (unsigned count);
+static unsigned pit_read (void);
+static bool pit_pending (void);
+static void timer_tick (void);
+//==================================================================
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
@@ -36,12 +60,10 @@ void
 timer_init (void) {
 	/* 8254 input frequency divided by TIMER_FREQ, rounded to
 	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
-
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
+	pit_count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+	pit_periodic ();
 
+	ktimer_init ();
 	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
@@ -127,11 +149,36 @@ timer_nsleep (int64_t ns) {
 void
 timer_print_stats (void) {
 	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+	if (timer_tickless)
+		printf ("Timer: %"PRId64" ticks skipped while idle\n", skipped_ticks);
 }
 
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED) {
+	int64_t elapsed = 1;
+
+	//==================================================================
+	//				Project 1 - Tickless Idle
+	//------------------------------------------------------------------
+	// one-shot  ׵  tick Ѳ ä ֱ  ư.
+	//  ͷƮ tick 迡 Ƿ ⼭ ٽ ѵ ֱⰡ ߳ ʴ´.
+	if (oneshot_ticks > 0)
+	{
+		elapsed = oneshot_ticks;
+		skipped_ticks += elapsed - 1;
+		oneshot_ticks = 0;
+		pit_periodic ();
+	}
+	//==================================================================
+
+	while (elapsed-- > 0)
+		timer_tick ();
+}
+
+/*  tick   Ѵ. */
+static void
+timer_tick (void) {
 	ticks++;
 	thread_tick ();
 
@@ -158,12 +205,103 @@ timer_interrupt (struct intr_frame *args UNUSED) {
 	//==================================================================
 
 	//==================================================================
-	//				Project 1 - Alarm Clock
+	//				Project 1 - Timer Wheel
 	//------------------------------------------------------------------
-	ThreadWakeUp(ticks); //  tick   尡 ִ Ȯϱ  ȣ 
+	ktimer_run(ticks); // ̹ tick  timer óѴ.  嵵 ⼭ .
 	//==================================================================
 }
 
+//==================================================================
+//				Project 1 - Tickless Idle
+//------------------------------------------------------------------
+
+/* idle 尡 hlt ϱ  θ. ͷƮ  ¿ Ѵ.
+    ̸ timer Ǵ tick 8254 one-shot ɾ  
+   ֱ ͷƮ ǳʶڴ. count 16Ʈ   ǳʶ  ִ 
+   65535 count, TIMER_FREQ 100̸ 5 tick ̴. */
+void
+timer_idle (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!timer_tickless || oneshot_ticks > 0 || pit_pending ())
+		return;
+
+	/* ֱ  count  tick  count. */
+	unsigned first = pit_read ();
+	if (first == 0 || first > pit_count)
+		return;
+
+	int64_t max = 1 + (0xffff - first) / pit_count;
+	int64_t delta = ktimer_next (ticks + max) - ticks;
+	if (delta <= 1)
+		return;
+
+	oneshot_ticks = delta;
+	pit_oneshot (first + (delta - 1) * pit_count);
+}
+
+/* one-shot  ٸ ͷƮ   ͷƮ   θ.
+   ̹  tick ä,  tick 迡 ͷƮ  ٽ Ǵ.
+    ڷδ timer_interrupt ֱ  ǵ. */
+void
+timer_idle_exit (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (oneshot_ticks <= 1 || pit_pending ())
+		return;
+
+	/* one-shot tick 迡 Ƿ  count  tick  ȴ.
+	   0̰ų   ũ ̹  0 Ʒ Ѿ ̴. */
+	unsigned remaining = pit_read ();
+	if (remaining == 0 || remaining > oneshot_ticks * pit_count)
+		return;
+
+	int64_t left = DIV_ROUND_UP (remaining, pit_count);
+	int64_t elapsed = oneshot_ticks - left;
+
+	pit_oneshot (remaining - (left - 1) * pit_count);
+	oneshot_ticks = 1;
+
+	skipped_ticks += elapsed;
+	while (elapsed-- > 0)
+		timer_tick ();
+}
+
+/* 8254 counter 0 TIMER_FREQ ֱ ͷƮ  Ǵ. */
+static void
+pit_periodic (void) {
+	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb (0x40, pit_count & 0xff);
+	outb (0x40, pit_count >> 8);
+}
+
+/* 8254 counter 0 COUNT ڿ   ͷƮ  Ǵ. */
+static void
+pit_oneshot (unsigned count) {
+	ASSERT (count > 0 && count <= 0xffff);
+
+	outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
+}
+
+/* 8254 counter 0  count д´. */
+static unsigned
+pit_read (void) {
+	outb (0x43, 0x00);    /* CW: latch counter 0. */
+	unsigned lo = inb (0x40);
+	unsigned hi = inb (0x40);
+	return (hi << 8) | lo;
+}
+
+/* timer ͷƮ PIC  ó ٸ  true. */
+static bool
+pit_pending (void) {
+	outb (0x20, 0x0a);    /* OCW3: read IRR. */
+	return inb (0x20) & 1;
+}
+//==================================================================
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
@@ -6,6 +6,9 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#ifdef VM
+#include "filesys/page_cache.h"
+#endif
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -156,6 +159,10 @@ inode_close (struct inode *inode) {
 	if (--inode->open_cnt == 0) {
 		/* Remove from inode list and release lock. */
 		list_remove (&inode->elem);
+#ifdef VM
+		/* === project3 - Page Cache === */
+		page_cache_drop (inode);
+#endif
 
 		/* Deallocate blocks if removed. */
 		if (inode->removed) {
@@ -180,7 +187,19 @@ inode_remove (struct inode *inode) {
  * Returns the number of bytes actually read, which may be less
  * than SIZE if an error occurs or end of file is reached. */
 off_t
-inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
+inode_read_at (struct inode *inode, void *buffer, off_t size, off_t offset) {
+#ifdef VM
+	/* === project3 - Page Cache === */
+	return page_cache_read (inode, buffer, size, offset);
+#else
+	return inode_read_disk (inode, buffer, size, offset);
+#endif
+}
+
+/* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET,
+ * straight from the disk without going through the page cache. */
+off_t
+inode_read_disk (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	uint8_t *buffer = buffer_;
 	off_t bytes_read = 0;
 	uint8_t *bounce = NULL;
@@ -231,7 +250,22 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
  * (Normally a write at end of file would extend the inode, but
  * growth is not yet implemented.) */
 off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size,
+inode_write_at (struct inode *inode, const void *buffer, off_t size,
+		off_t offset) {
+	off_t bytes_written = inode_write_disk (inode, buffer, size, offset);
+#ifdef VM
+	/* === project3 - Page Cache === */
+	/* 디스크에 먼저 쓰고 캐시에 올라온 페이지도 같이 고친다. */
+	page_cache_write (inode, buffer, bytes_written, offset);
+#endif
+	return bytes_written;
+}
+
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET,
+ * straight to the disk.  Pages of INODE in the page cache are
+ * left as they are. */
+off_t
+inode_write_disk (struct inode *inode, const void *buffer_, off_t size,
 		off_t offset) {
 	const uint8_t *buffer = buffer_;
 	off_t bytes_written = 0;
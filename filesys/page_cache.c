@@ -48,3 +48,411 @@ page_cache_destroy (struct page *page) {
 static void
 page_cache_kworkerd (void *aux) {
 }
+
+/* === project3 - Page Cache === */
+#ifdef VM
+#include <round.h>
+#include <string.h>
+#include "filesys/inode.h"
+#include "filesys/page_cache.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* (inode, 페이지 오프셋)으로 frame을 찾는 색인. frame_lock으로 보호한다.
+ * 색인에 올라가는 frame은 두 가지이다.
+ *  - read()가 채운 frame: page와 owner가 NULL이며 clock이 알아서 버린다.
+ *  - 파일 매핑 페이지의 frame: 매핑이 frame을 놓을 때 색인에서 빠진다.
+ * 그래서 read()와 mmap이 같은 파일 페이지를 쓰면 메모리에는 한 벌만 있다.
+ * write()는 디스크에 바로 쓰고(write-through) 캐시도 함께 고치므로,
+ * 캐시에만 있는 frame은 언제나 디스크와 같아 버릴 때 쓸 필요가 없다. */
+static struct hash cache_index;
+static bool cache_ready;
+
+/* 디스크에 쓸 때마다 하나씩 늘어난다. 디스크에서 읽어 온 frame을 색인에
+ * 올리기 전에 값이 바뀌었다면, 읽는 사이에 쓰인 내용을 놓쳤을 수 있으므로
+ * 올리지 않는다. */
+static unsigned long cache_seq;
+
+static uint64_t
+cache_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct frame *frame = hash_entry (e, struct frame, cache_elem);
+
+	return hash_bytes (&frame->cache_inode, sizeof frame->cache_inode)
+		^ hash_int (frame->cache_ofs / PGSIZE);
+}
+
+static bool
+cache_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct frame *a = hash_entry (a_, struct frame, cache_elem);
+	const struct frame *b = hash_entry (b_, struct frame, cache_elem);
+
+	if (a->cache_inode != b->cache_inode)
+		return a->cache_inode < b->cache_inode;
+	return a->cache_ofs < b->cache_ofs;
+}
+
+/* frame table이 준비된 뒤 vm_init에서 부른다. 그 전의 파일 입출력은
+ * 캐시를 거치지 않는다. */
+void
+page_cache_init (void) {
+	hash_init (&cache_index, cache_hash, cache_less, NULL);
+	cache_seq = 0;
+	cache_ready = true;
+}
+
+/* INODE의 OFS 페이지를 담은 frame을 찾는다. frame_lock을 잡은 상태여야 한다. */
+static struct frame *
+cache_lookup (struct inode *inode, off_t ofs) {
+	struct frame key;
+	struct hash_elem *e;
+
+	key.cache_inode = inode;
+	key.cache_ofs = ofs;
+	e = hash_find (&cache_index, &key.cache_elem);
+	return e != NULL ? hash_entry (e, struct frame, cache_elem) : NULL;
+}
+
+/* FRAME을 INODE의 OFS 페이지로 색인에 올린다. frame_lock을 잡은 상태여야 한다. */
+static void
+cache_link (struct frame *frame, struct inode *inode, off_t ofs) {
+	frame->cache_inode = inode;
+	frame->cache_ofs = ofs;
+	frame->cache_accessed = true;
+	hash_insert (&cache_index, &frame->cache_elem);
+}
+
+/* FRAME을 색인에서 뺀다. frame_lock을 잡은 상태여야 한다. */
+void
+page_cache_unlink (struct frame *frame) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	if (frame->cache_inode != NULL) {
+		hash_delete (&cache_index, &frame->cache_elem);
+		frame->cache_inode = NULL;
+	}
+}
+
+/* FRAME이 매핑 없이 캐시에만 있는지 확인한다. */
+bool
+page_cache_only (const struct frame *frame) {
+	return frame->cache_inode != NULL && frame->owner == NULL;
+}
+
+/* FRAME을 색인에서 빼고, 캐시에만 있던 frame이면 user pool에 돌려준다.
+ * frame_lock을 잡은 상태여야 한다. */
+static void
+cache_evict (struct frame *frame) {
+	bool only = page_cache_only (frame);
+
+	page_cache_unlink (frame);
+	if (only)
+		frame_put (frame, NULL);
+}
+
+/* 파일 OFS부터 READ_BYTES를 읽은 페이지가 파일의 그 페이지를 온전히
+ * 담는지 확인한다. 한 페이지를 다 읽었거나 파일 끝까지 읽었어야 한다. */
+static bool
+cache_eligible (struct inode *inode, off_t ofs, size_t read_bytes) {
+	return read_bytes == PGSIZE
+		|| ofs + (off_t) read_bytes >= inode_length (inode);
+}
+
+/* INODE의 OFS 페이지를 디스크에서 새 frame으로 읽는다. 반환된 frame은
+ * 아직 색인에 없고 pinned 상태이다. frame을 얻지 못하면 NULL을 반환한다. */
+static struct frame *
+cache_fill (struct inode *inode, off_t ofs) {
+	off_t left = inode_length (inode) - ofs;
+	off_t read_bytes = left < PGSIZE ? left : PGSIZE;
+	struct frame *frame = vm_get_frame ();
+
+	if (frame == NULL)
+		return NULL;
+	if (inode_read_disk (inode, frame->kva, read_bytes, ofs) != read_bytes) {
+		lock_acquire (&frame_lock);
+		frame_put (frame, NULL);
+		lock_release (&frame_lock);
+		return NULL;
+	}
+	memset ((uint8_t *) frame->kva + read_bytes, 0, PGSIZE - read_bytes);
+	return frame;
+}
+
+/* INODE의 OFFSET부터 SIZE 바이트를 DST로 복사한다. OFFSET부터 SIZE
+ * 바이트는 한 페이지 안에 있어야 한다. 캐시에 없는 페이지는 통째로
+ * 읽어 캐시에 올린다. frame을 얻지 못하면 false를 반환한다. */
+static bool
+cache_copy_out (struct inode *inode, off_t offset, void *dst, size_t size) {
+	struct thread *curr = thread_current ();
+	off_t ofs = ROUND_DOWN (offset, PGSIZE);
+	uint8_t *src;
+
+	lock_acquire (&frame_lock);
+	struct frame *frame = cache_lookup (inode, ofs);
+	if (frame != NULL) {
+		vm_stat_add (curr, cache_hits, 1);
+		frame->cache_accessed = true;
+		src = (uint8_t *) frame->kva + (offset - ofs);
+		memcpy (dst, src, size);
+		lock_release (&frame_lock);
+		return true;
+	}
+	unsigned long seq = cache_seq;
+	lock_release (&frame_lock);
+
+	frame = cache_fill (inode, ofs);
+	if (frame == NULL)
+		return false;
+	vm_stat_add (curr, cache_misses, 1);
+	src = (uint8_t *) frame->kva + (offset - ofs);
+	memcpy (dst, src, size);
+
+	/* 다른 스레드가 먼저 올렸거나 읽는 사이에 파일이 바뀌었다면
+	 * 이번 읽기에만 쓰고 버린다. */
+	lock_acquire (&frame_lock);
+	if (seq == cache_seq && cache_lookup (inode, ofs) == NULL) {
+		frame->owner = NULL;
+		frame->pinned = false;
+		cache_link (frame, inode, ofs);
+	} else
+		frame_put (frame, NULL);
+	lock_release (&frame_lock);
+	return true;
+}
+
+/* INODE의 OFFSET부터 SIZE 바이트를 페이지 캐시를 거쳐 BUFFER로 읽는다.
+ * BUFFER는 사용자 메모리일 수 있다. frame_lock을 잡은 채 복사하다
+ * page fault가 나면 안 되므로 BOUNCE로 옮긴 뒤 락을 풀고 복사한다.
+ * 캐시에 올리지 못한 부분은 디스크에서 바로 읽는다. */
+off_t
+page_cache_read (struct inode *inode, void *buffer_, off_t size,
+		off_t offset) {
+	uint8_t *buffer = buffer_;
+	off_t length = inode_length (inode);
+	off_t bytes_read = 0;
+	uint8_t *bounce = NULL;
+
+	if (!cache_ready)
+		return inode_read_disk (inode, buffer, size, offset);
+
+	while (size > 0 && offset < length) {
+		/* 이번 페이지에서 읽을 바이트 수 */
+		off_t chunk_size = PGSIZE - offset % PGSIZE;
+		if (chunk_size > size)
+			chunk_size = size;
+		if (chunk_size > length - offset)
+			chunk_size = length - offset;
+
+		if (bounce == NULL) {
+			bounce = malloc (size < PGSIZE ? size : PGSIZE);
+			if (bounce == NULL)
+				break;
+		}
+		if (!cache_copy_out (inode, offset, bounce, chunk_size)
+				&& inode_read_disk (inode, bounce, chunk_size, offset)
+					!= chunk_size)
+			break;
+		memcpy (buffer + bytes_read, bounce, chunk_size);
+
+		/* Advance. */
+		size -= chunk_size;
+		offset += chunk_size;
+		bytes_read += chunk_size;
+	}
+	free (bounce);
+
+	return bytes_read;
+}
+
+/* 디스크에 막 쓴 INODE의 OFFSET부터 SIZE 바이트를 캐시에 올라온
+ * 페이지에도 반영한다. 파일 매핑 페이지의 frame이면 매핑한 프로세스도
+ * 바뀐 내용을 본다. */
+void
+page_cache_write (struct inode *inode, const void *buffer_, off_t size,
+		off_t offset) {
+	const uint8_t *buffer = buffer_;
+	uint8_t *bounce = NULL;
+
+	if (!cache_ready)
+		return;
+
+	while (size > 0) {
+		off_t ofs = ROUND_DOWN (offset, PGSIZE);
+		off_t chunk_size = PGSIZE - (offset - ofs);
+		if (chunk_size > size)
+			chunk_size = size;
+
+		lock_acquire (&frame_lock);
+		cache_seq++;
+		bool cached = cache_lookup (inode, ofs) != NULL;
+		lock_release (&frame_lock);
+
+		if (cached) {
+			if (bounce == NULL)
+				bounce = malloc (PGSIZE);
+			if (bounce != NULL)
+				memcpy (bounce, buffer, chunk_size);
+
+			/* bounce를 얻지 못하면 옛 내용이 남지 않도록 캐시에서 뺀다. */
+			lock_acquire (&frame_lock);
+			struct frame *frame = cache_lookup (inode, ofs);
+			if (frame != NULL && bounce != NULL)
+				memcpy ((uint8_t *) frame->kva + (offset - ofs), bounce,
+						chunk_size);
+			else if (frame != NULL)
+				cache_evict (frame);
+			lock_release (&frame_lock);
+		}
+
+		size -= chunk_size;
+		offset += chunk_size;
+		buffer += chunk_size;
+	}
+	free (bounce);
+}
+
+/* 파일 매핑 페이지를 채울 FRAME에 INODE의 OFS 페이지를 캐시에서
+ * READ_BYTES만큼 복사한다. 캐시에만 있던 frame이었다면 그 frame은
+ * 돌려주고 FRAME이 캐시 자리를 넘겨받는다. 캐시에 없으면 false를
+ * 반환하며, 호출자가 디스크에서 읽은 뒤 page_cache_adopt를 부른다. */
+bool
+page_cache_load (struct inode *inode, off_t ofs, struct frame *frame,
+		size_t read_bytes) {
+	struct thread *curr = thread_current ();
+
+	if (!cache_ready)
+		return false;
+
+	lock_acquire (&frame_lock);
+	struct frame *cached = cache_lookup (inode, ofs);
+	if (cached == NULL || cached == frame) {
+		vm_stat_add (curr, cache_misses, 1);
+		lock_release (&frame_lock);
+		return false;
+	}
+
+	vm_stat_add (curr, cache_hits, 1);
+	memcpy (frame->kva, cached->kva, read_bytes);
+	if (page_cache_only (cached) && cache_eligible (inode, ofs, read_bytes)) {
+		cache_evict (cached);
+		cache_link (frame, inode, ofs);
+	}
+	lock_release (&frame_lock);
+	return true;
+}
+
+/* 파일 매핑 페이지를 채우려고 디스크에서 INODE의 OFS 페이지를 READ_BYTES만큼
+ * 읽은 FRAME을 캐시에 올린다. SEQ는 읽기 전에 page_cache_seq로 얻은 값이다.
+ * 다른 매핑의 frame이 이미 올라 있으면 그대로 둔다. */
+void
+page_cache_adopt (struct frame *frame, struct inode *inode, off_t ofs,
+		size_t read_bytes, unsigned long seq) {
+	if (!cache_ready || !cache_eligible (inode, ofs, read_bytes))
+		return;
+
+	lock_acquire (&frame_lock);
+	if (seq == cache_seq) {
+		struct frame *cached = cache_lookup (inode, ofs);
+		if (cached != NULL && page_cache_only (cached)) {
+			cache_evict (cached);
+			cached = NULL;
+		}
+		if (cached == NULL)
+			cache_link (frame, inode, ofs);
+	}
+	lock_release (&frame_lock);
+}
+
+/* === project3 - Shared Text === */
+/* 실행 파일의 읽기 전용 페이지를 여러 프로세스가 함께 매핑하도록,
+ * INODE의 OFS 페이지를 담은 캐시 frame을 PAGE의 frame으로 붙이고
+ * sharers에 넣는다. 캐시에 없으면 읽어 올린다. 매핑할 페이지의 내용
+ * (READ_BYTES 뒤는 0)이 캐시 frame과 같지 않거나 frame을 얻지 못하면
+ * false를 반환한다. 매핑이 모두 떠나거나 clock이 매핑을 모두 끊으면
+ * frame은 다시 캐시에만 있는 frame이 된다. */
+bool
+page_cache_share (struct inode *inode, off_t ofs, size_t read_bytes,
+		struct page *page) {
+	struct thread *curr = thread_current ();
+	off_t left = inode_length (inode) - ofs;
+
+	if (!cache_ready || ofs % PGSIZE != 0
+			|| (off_t) read_bytes != (left < PGSIZE ? left : PGSIZE))
+		return false;
+
+	lock_acquire (&frame_lock);
+	struct frame *frame = cache_lookup (inode, ofs);
+	unsigned long seq = cache_seq;
+	lock_release (&frame_lock);
+
+	struct frame *fill = NULL;
+	if (frame == NULL) {
+		fill = cache_fill (inode, ofs);
+		if (fill == NULL)
+			return false;
+		vm_stat_add (curr, cache_misses, 1);
+	} else
+		vm_stat_add (curr, cache_hits, 1);
+
+	lock_acquire (&frame_lock);
+	frame = cache_lookup (inode, ofs);
+	if (fill != NULL) {
+		if (frame == NULL && seq == cache_seq) {
+			fill->owner = NULL;
+			fill->pinned = false;
+			cache_link (fill, inode, ofs);
+			frame = fill;
+		} else
+			frame_put (fill, NULL);
+	}
+	/* 파일 매핑 페이지의 frame은 그 매핑의 것이므로 함께 쓰지 않는다. */
+	if (frame != NULL && page_cache_only (frame)) {
+		frame_share (frame, page);
+		frame->cache_accessed = true;
+		page->frame = frame;
+	} else
+		frame = NULL;
+	lock_release (&frame_lock);
+	return frame != NULL;
+}
+
+/* 디스크에서 읽기 전에 불러 두었다가 page_cache_adopt에 넘긴다. */
+unsigned long
+page_cache_seq (void) {
+	return cache_seq;
+}
+
+/* 파일 매핑 페이지의 frame KEEP의 내용을 캐시를 거치지 않고 INODE의
+ * OFS 페이지에 쓰기 직전에 부른다. 색인에 다른 frame이 있으면 옛 내용이므로
+ * 뺀다. frame_lock을 잡은 상태여야 한다. */
+void
+page_cache_invalidate (struct inode *inode, off_t ofs, struct frame *keep) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	if (!cache_ready)
+		return;
+
+	cache_seq++;
+	struct frame *frame = cache_lookup (inode, ofs);
+	if (frame != NULL && frame != keep)
+		cache_evict (frame);
+}
+
+/* 마지막으로 닫히는 INODE의 페이지를 모두 캐시에서 뺀다. */
+void
+page_cache_drop (struct inode *inode) {
+	if (!cache_ready)
+		return;
+
+	off_t length = inode_length (inode);
+
+	lock_acquire (&frame_lock);
+	for (off_t ofs = 0; ofs < length; ofs += PGSIZE) {
+		struct frame *frame = cache_lookup (inode, ofs);
+		if (frame != NULL)
+			cache_evict (frame);
+	}
+	lock_release (&frame_lock);
+}
+#endif
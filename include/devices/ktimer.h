@@ -0,0 +1,35 @@
+#ifndef DEVICES_KTIMER_H
+#define DEVICES_KTIMER_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+//==================================================================
+//				Project 1 - Timer Wheel
+//------------------------------------------------------------------
+
+/* 만료될 때 timer 인터럽트 안에서(인터럽트가 꺼진 채로) 호출된다. */
+typedef void ktimer_func (void *aux);
+
+/* 정해진 tick에 콜백을 부르는 커널 timer.
+   구조체는 호출한 쪽이 가지고 있고, ktimer_setup()으로 한 번 초기화한
+   뒤에는 몇 번이고 arm/cancel 할 수 있다. */
+struct ktimer {
+	struct list_elem elem;      /* wheel의 slot 리스트 원소 */
+	int64_t expires;            /* 만료 tick */
+	ktimer_func *func;          /* 만료 때 부를 함수 */
+	void *aux;                  /* FUNC의 인자 */
+	bool pending;               /* wheel에 올라 있으면 true */
+};
+
+void ktimer_init (void);
+void ktimer_setup (struct ktimer *, ktimer_func *, void *aux);
+void ktimer_arm (struct ktimer *, int64_t expires);
+bool ktimer_cancel (struct ktimer *);
+void ktimer_run (int64_t now);
+int64_t ktimer_next (int64_t limit);
+
+//==================================================================
+
+#endif /* devices/ktimer.h */
@@ -9,4 +9,25 @@ struct page_cache {};
 
 void page_cache_init (void);
 bool page_cache_initializer (struct page *page, enum vm_type type, void *kva);
+
+/* === project3 - Page Cache === */
+struct frame;
+struct inode;
+
+off_t page_cache_read (struct inode *inode, void *buffer, off_t size,
+		off_t offset);
+void page_cache_write (struct inode *inode, const void *buffer, off_t size,
+		off_t offset);
+bool page_cache_load (struct inode *inode, off_t ofs, struct frame *frame,
+		size_t read_bytes);
+void page_cache_adopt (struct frame *frame, struct inode *inode, off_t ofs,
+		size_t read_bytes, unsigned long seq);
+unsigned long page_cache_seq (void);
+void page_cache_invalidate (struct inode *inode, off_t ofs,
+		struct frame *keep);
+void page_cache_unlink (struct frame *frame);
+bool page_cache_only (const struct frame *frame);
+void page_cache_drop (struct inode *inode);
+bool page_cache_share (struct inode *inode, off_t ofs, size_t read_bytes,
+		struct page *page);
 #endif
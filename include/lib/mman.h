@@ -0,0 +1,17 @@
+#ifndef __LIB_MMAN_H
+#define __LIB_MMAN_H
+
+/* Advice values for madvise().  NORMAL, RANDOM and SEQUENTIAL are
+   remembered for each page of the range; WILLNEED and DONTNEED act
+   on the range once. */
+#define MADV_NORMAL     0       /* Default readahead and eviction. */
+#define MADV_RANDOM     1       /* No readahead or fault-around. */
+#define MADV_SEQUENTIAL 2       /* Read far ahead, evict behind. */
+#define MADV_WILLNEED   3       /* Read the range in now. */
+#define MADV_DONTNEED   4       /* Drop the range's contents. */
+
+/* Flag for mmap_flags()'s FLAGS argument: read the whole mapping in
+   and map it before returning, instead of on first access. */
+#define MAP_POPULATE    0x1
+
+#endif /* lib/mman.h */
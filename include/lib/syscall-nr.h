@@ -36,6 +36,12 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extra for Project 3 */
+	SYS_VMSTAT,                 /* Read virtual memory statistics. */
+	SYS_MADVISE,                /* Give advice about use of memory. */
+	SYS_PREFAULT,               /* Read in and map a range of memory. */
+	SYS_SBRK,                   /* Move the end of the heap. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -4,6 +4,9 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <mman.h>
+#include <vm-stats.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -40,7 +43,13 @@ int dup2(int oldfd, int newfd);
 
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
+void *mmap_flags (void *addr, size_t length, int writable, int fd,
+		off_t offset, int flags);
 void munmap (void *addr);
+bool vmstat (bool global, struct vm_stats *stats);
+int madvise (void *addr, size_t length, int advice);
+int prefault (void *addr, size_t length);
+void *sbrk (intptr_t increment);
 
 /* Project 4 only. */
 bool chdir (const char *dir);
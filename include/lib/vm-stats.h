@@ -0,0 +1,29 @@
+#ifndef __LIB_VM_STATS_H
+#define __LIB_VM_STATS_H
+
+/* Virtual memory counters, kept for each process and for the whole
+   system.  Read with the vmstat() system call. */
+struct vm_stats {
+	long long faults;               /* Page faults handled. */
+	long long minor_faults;         /* ...resolved without disk I/O. */
+	long long major_faults;         /* ...that had to read the disk. */
+	long long uninit_faults;        /* ...on a page never touched before. */
+	long long anon_faults;          /* ...on an anonymous page. */
+	long long file_faults;          /* ...on a file-backed page. */
+	long long cow_copies;           /* Pages copied on write after fork. */
+	long long stack_growths;        /* Pages added by stack growth. */
+	long long evictions;            /* Pages evicted from memory. */
+	long long swap_ins;             /* Pages read back from swap. */
+	long long swap_outs;            /* Pages written to swap. */
+	long long readahead_pages;      /* Pages read ahead from swap. */
+	long long readahead_hits;       /* ...that were used afterwards. */
+	long long fault_around_pages;   /* Pages populated around faults. */
+	long long huge_maps;            /* 2 MB regions mapped whole. */
+	long long cache_hits;           /* File pages found in the page cache. */
+	long long cache_misses;         /* ...that had to be read from disk. */
+	long long ksm_merges;           /* Pages merged into an identical one. */
+	long long rss;                  /* Resident pages now. */
+	long long peak_rss;             /* Highest RSS so far. */
+};
+
+#endif /* lib/vm-stats.h */
@@ -4,6 +4,7 @@
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#include "devices/ktimer.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #ifdef VM
@@ -111,7 +112,7 @@ struct thread {
 	//==================================================================
 	//				Project 1 - Alarm Clock
 	//------------------------------------------------------------------
-	int64_t				wakeup_ticks;
+	struct ktimer		sleep_timer;		/* 잠든 스레드를 깨울 timer */
 	//==================================================================
 
 	//==================================================================
@@ -135,6 +136,7 @@ struct thread {
 	//------------------------------------------------------------------
 	int 				nice;
 	int 				recent_cpu;
+	int64_t				mlfqs_epoch;		/* recent_cpu를 몇 초째까지 줄였는지 */
 	struct list_elem	allelem;
 	//==================================================================
 
@@ -163,6 +165,8 @@ struct thread {
 #ifdef VM
 	/* Table for whole virtual memory owned by thread. */
 	struct supplemental_page_table spt;
+	/* === project3 - Stack Growth === */
+	void *user_rsp;			// syscall 진입 시점의 사용자 rsp
 #endif
 
 	/* Owned by thread.c. */
@@ -208,16 +212,10 @@ void do_iret (struct intr_frame *tf);
 //				Project 1 - Alarm Clock
 //------------------------------------------------------------------
 
-/* ��� �����带 sleep_list�� �������ش�.
-	�� �� ticks�� ���� �����尡 �պκп� ��ġ�ϵ��� �����Ͽ� �����Ѵ�. */
+/* 현재 스레드를 ticks 시각까지 재운다.
+	sleep_timer를 timer wheel에 걸어 두고 block 하므로 O(1)이다. */
 void ThreadSleep(int64_t ticks);
 
-// ticks�� �������� ������ �� ����ϴ� �Լ�
-bool CompareThreadByTicks(const struct list_elem* l, const struct list_elem* r, void *aux UNUSED);
-
-// sleep_list�� Ȯ���ؼ� �ƾ ��������� ready_list�� �Ű��ִ� �Լ� 
-void ThreadWakeUp(int64_t current_ticks);
-
 //==================================================================
 
 
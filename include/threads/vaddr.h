@@ -31,6 +31,18 @@
 /* Round down to nearest page boundary. */
 #define pg_round_down(va) (void *) ((uint64_t) (va) & ~PGMASK)
 
+/* 2 MB large page offset (bits 0:21). */
+#define HPGBITS  21                        /* Number of offset bits. */
+#define HPGSIZE  (1 << HPGBITS)            /* Bytes in a large page. */
+#define HPGMASK  BITMASK(PGSHIFT, HPGBITS) /* Large page offset bits. */
+#define HPG_PAGES (HPGSIZE / PGSIZE)       /* Pages in a large page. */
+
+/* Offset within a large page. */
+#define hpg_ofs(va) ((uint64_t) (va) & HPGMASK)
+
+/* Round down to nearest large page boundary. */
+#define hpg_round_down(va) (void *) ((uint64_t) (va) & ~HPGMASK)
+
 /* Kernel virtual address start */
 #define KERN_BASE LOADER_KERN_BASE
 
@@ -3,9 +3,15 @@
 
 /* === project2 - System Call === */
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/synch.h"
+#include "filesys/off_t.h"
 
 typedef int pid_t;
 
+extern struct lock filesys_lock;
+
 void check_address(void *addr);
 void halt(void);
 void exit(int status);
@@ -20,5 +26,21 @@ int tell(int fd);
 void close(int fd);
 int dup2(int oldfd, int newfd);
 
+/* === project3 - Memory Mapped Files === */
+void *mmap(void *addr, size_t length, int writable, int fd, off_t offset,
+		int flags);
+void munmap(void *addr);
+
+/* === project3 - VM Statistics === */
+struct vm_stats;
+bool vmstat(bool global, struct vm_stats *stats);
+
+/* === project3 - madvise === */
+int madvise(void *addr, size_t length, int advice);
+int prefault(void *addr, size_t length);
+
+/* === project3 - Anonymous Memory === */
+void *sbrk(intptr_t increment);
+
 void syscall_init(void);
 #endif /* userprog/syscall.h */
@@ -2,12 +2,36 @@
 #define VM_ANON_H
 #include "vm/vm.h"
 struct page;
+struct zswap_entry;
 enum vm_type;
 
 struct anon_page {
+	size_t swap_slot;       /* swap 슬롯 번호, 사본이 없으면 SWAP_SLOT_NONE */
+	bool prefetched;        /* readahead로 읽어 두고 아직 매핑하지 않음 */
+	struct zswap_entry *zswap;  /* 압축 swap 캐시의 사본, 없으면 NULL */
 };
 
+/* 아직 swap 되지 않은 페이지의 swap_slot 값 */
+#define SWAP_SLOT_NONE ((size_t) -1)
+
+/* 한 번에 묶어서 내보낼 수 있는 최대 페이지 수 */
+#define SWAP_CLUSTER 8
+
+/* swap-in 때 함께 읽어 둘 수 있는 최대 페이지 수 */
+#define SWAP_READAHEAD_MAX 8
+
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+bool anon_clean (struct page *page, const void *buf);
+void anon_read_slot (struct page *page, void *kva);
+size_t anon_reserve_slots (size_t cnt);
+void anon_swap_out_cluster (struct page **pages, size_t cnt, size_t slot);
+void anon_read_slots (size_t slot, size_t cnt, void **kvas);
+bool anon_spill (struct page *page, const void *buf);
+void anon_attach_slot (struct page *page, size_t slot);
+bool anon_slot_shared (size_t slot);
+void anon_write_shared (size_t slot, const void *kva);
+void *anon_find_area (size_t length);
+void *do_mmap_anon (void *addr, size_t length, bool writable);
 
 #endif
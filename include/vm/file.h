@@ -7,10 +7,18 @@ struct page;
 enum vm_type;
 
 struct file_page {
+	/* === project3 - Memory Mapped Files === */
+	struct file *file;      /* 페이지가 매핑된 파일 (페이지마다 reopen) */
+	off_t ofs;              /* 파일 내 오프셋 */
+	size_t read_bytes;      /* 파일에서 읽은 바이트 수 */
+	size_t zero_bytes;      /* 0으로 채운 바이트 수 */
 };
 
 void vm_file_init (void);
 bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
+bool file_backed_clean (struct page *page, const void *buf);
+void file_backed_invalidate (struct page *page);
+void file_backed_drop (struct page *page);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *va);
@@ -0,0 +1,8 @@
+#ifndef VM_KSM_H
+#define VM_KSM_H
+
+/* === project3 - Same-Page Merging === */
+void ksm_init (void);
+void ksm_print_stats (void);
+
+#endif /* vm/ksm.h */
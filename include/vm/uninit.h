@@ -1,12 +1,23 @@
 #ifndef VM_UNINIT_H
 #define VM_UNINIT_H
 #include "vm/vm.h"
+#include "filesys/off_t.h"
 
 struct page;
+struct file;
 enum vm_type;
 
 typedef bool vm_initializer (struct page *, void *aux);
 
+/* === project3 - Anonymous Page === */
+/* lazy loading 때 파일에서 읽어올 위치 정보 (initializer의 aux) */
+struct lazy_load_arg {
+	struct file *file;      /* 읽어올 파일 */
+	off_t ofs;              /* 파일 내 오프셋 */
+	size_t read_bytes;      /* 파일에서 읽을 바이트 수 */
+	size_t zero_bytes;      /* 나머지를 0으로 채울 바이트 수 */
+};
+
 /* Uninitlialized page. The type for implementing the
  * "Lazy loading". */
 struct uninit_page {
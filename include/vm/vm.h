@@ -1,7 +1,14 @@
 #ifndef VM_VM_H
 #define VM_VM_H
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <hash.h>
+#include <list.h>
+#include <mman.h>
+#include <vm-stats.h>
 #include "threads/palloc.h"
+#include "threads/synch.h"
 
 enum vm_type {
 	/* page not initialized */
@@ -46,6 +53,21 @@ struct page {
 	struct frame *frame;   /* Back reference for frame */
 
 	/* Your implementation */
+	/* === project3 - Memory Management === */
+	bool writable;         /* 사용자 쓰기 가능 여부 */
+	size_t mmap_cnt;       /* mmap 시작 페이지라면 매핑된 페이지 수, 아니면 0 */
+
+	/* === project3 - madvise === */
+	int advice;            /* MADV_NORMAL, MADV_RANDOM, MADV_SEQUENTIAL */
+	/* 실행 파일 세그먼트의 익명 페이지면 처음 읽어 온 위치.
+	 * MADV_DONTNEED가 페이지를 lazy loading 상태로 되돌릴 때 쓴다. */
+	vm_initializer *seg_init;  /* 세그먼트 페이지가 아니면 NULL */
+	off_t seg_ofs;             /* run_file 안의 오프셋 */
+	size_t seg_read_bytes;     /* 파일에서 읽는 바이트 수 */
+
+	/* === project3 - Copy On Write === */
+	struct thread *owner;  /* 이 페이지가 들어 있는 SPT의 스레드 */
+	struct list_elem share_elem;  /* frame->sharers의 원소 */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -63,8 +85,73 @@ struct page {
 struct frame {
 	void *kva;
 	struct page *page;
+
+	/* === project3 - Memory Management === */
+	struct thread *owner;  /* page를 매핑한 스레드 (pml4 접근용) */
+	bool pinned;           /* true면 eviction 대상에서 제외 */
+	bool queued;           /* cleaner 큐에 들어가 있는지 여부 */
+	bool io;               /* frame_lock 없이 디스크에 쓰는 중 (그동안 pinned) */
+
+	/* === project3 - Copy On Write === */
+	/* 이 frame을 매핑한 페이지 수. 1보다 크면 fork나 ksmd로 공유 중이며
+	 * 모든 매핑이 읽기 전용이다. page, owner는 대표 매핑 하나를 가리키고
+	 * 나머지 매핑은 sharers에 있다. 대표가 떠나면 sharers의 맨 앞 페이지가
+	 * 대표가 된다. 페이지 캐시와 zero frame은 대표 없이(page가 NULL)
+	 * 공유한다. 페이지 캐시 frame의 매핑은 모두 sharers에 있고,
+	 * zero frame의 매핑은 sharers에 넣지 않는다. */
+	size_t ref_cnt;
+	struct list sharers;
+	/* 여러 페이지가 함께 가리키는 swap 슬롯에서 읽어 와 swap 캐시에
+	 * 올라 있으면 그 슬롯, 아니면 SWAP_SLOT_NONE. 캐시에 있는 동안은
+	 * 슬롯과 내용이 같도록 모든 매핑이 읽기 전용이다. */
+	size_t swap_slot;
+	struct hash_elem swap_elem;
+
+	/* === project3 - Page Cache === */
+	/* 페이지 캐시에 올라간 frame이면 파일의 어느 페이지를 담고 있는지.
+	 * 매핑 없이 캐시에만 있는 frame은 page와 owner가 NULL이다. */
+	struct inode *cache_inode;  /* 담고 있는 파일, 캐시에 없으면 NULL */
+	off_t cache_ofs;            /* 파일 안의 페이지 오프셋 */
+	bool cache_accessed;        /* 캐시에만 있을 때 쓰는 accessed 비트 */
+	struct hash_elem cache_elem;
+
+	/* === project3 - Same-Page Merging === */
+	uint64_t ksm_checksum;      /* ksmd가 지난 바퀴에 본 내용의 checksum */
 };
 
+/* frame table과 clock hand를 보호한다. */
+extern struct lock frame_lock;
+
+/* If false (default), evict with plain clock.
+   If true, use WSClock, which prefers frames that can be dropped
+   without I/O and hands dirty ones to a background cleaner.
+   Controlled by kernel command-line option "-wsclock". */
+extern bool vm_wsclock;
+
+/* Number of following pages to populate together on a fault in a
+   file-backed or lazily loaded executable page, up to
+   FAULT_AROUND_MAX.  0 disables fault-around.
+   Controlled by kernel command-line option "-fa=PAGES". */
+#define FAULT_AROUND_MAX 16
+extern size_t vm_fault_around;
+
+/* If true, swapped-out anonymous pages are first compressed into an
+   in-memory cache and only spilled to the swap disk when it fills up.
+   Controlled by kernel command-line option "-zswap". */
+extern bool vm_zswap;
+
+/* If true (default), a fault in a large, 2 MB aligned region whose
+   pages were never touched populates the whole region and maps it
+   with a single large page.
+   Disabled by kernel command-line option "-nohuge". */
+extern bool vm_huge_pages;
+
+/* Number of frames the background thread "ksmd" scans every 100 ms
+   for anonymous pages with identical contents, which it merges into
+   one read-only copy-on-write frame.  0 (default) disables merging.
+   Controlled by kernel command-line option "-ksm=PAGES". */
+extern size_t vm_ksm;
+
 /* The function table for page operations.
  * This is one way of implementing "interface" in C.
  * Put the table of "method" into the struct's member, and
@@ -81,12 +168,53 @@ struct page_operations {
 #define destroy(page) \
 	if ((page)->operations->destroy) (page)->operations->destroy (page)
 
+/* === project3 - Memory Management === */
+/* 스택이 자랄 수 있는 최대 크기 (1MB) */
+#define STACK_LIMIT (1 << 20)
+
+/* 스택 페이지 표시용 마커 */
+#define VM_STACK VM_MARKER_0
+
 /* Representation of current process's memory space.
  * We don't want to force you to obey any specific design for this struct.
  * All designs up to you for this. */
+/* threads/mmu.c의 pml4 -> pdpe -> pgdir -> pt 구조를 그대로 따라가는
+ * 4단계 radix tree.  각 노드는 palloc 페이지 하나(512개 포인터)이고,
+ * 마지막 단계(leaf)는 struct page 포인터를 담는다.
+ * 같은 2MB 구간을 연속으로 찾는 경우가 대부분이므로 마지막으로 찾은
+ * leaf를 기억해 두고, 다음 조회 때 트리를 타지 않고 바로 사용한다. */
 struct supplemental_page_table {
+	void **root;                /* pml4 단계 노드 */
+	struct page **hint_leaf;    /* 마지막으로 조회한 leaf 노드 */
+	uint64_t hint_key;          /* hint_leaf가 담당하는 va >> PDXSHIFT */
+	size_t page_cnt;            /* 등록된 페이지 수 */
+
+	/* === project3 - Swap Readahead === */
+	size_t ra_window;           /* swap-in 때 함께 읽을 페이지 수 */
+	void *ra_last;              /* 마지막으로 swap-in 한 페이지 */
+
+	/* === project3 - Batched Unmap === */
+	bool unmapping;             /* vm_unmap_begin ~ vm_unmap_end 사이 */
+
+	/* === project3 - VM Statistics === */
+	struct vm_stats stats;      /* 이 프로세스의 통계, exec 때 새로 시작 */
+
+	/* === project3 - Anonymous Memory === */
+	void *heap_start;           /* 실행 파일 바로 뒤, 힙이 시작하는 주소 */
+	void *brk;                  /* 힙의 끝 (sbrk가 옮긴다) */
 };
 
+/* 모든 프로세스를 합친 통계 */
+extern struct vm_stats vm_stats;
+
+/* 스레드 T와 전체 통계의 FIELD에 N을 더한다. */
+#define vm_stat_add(T, FIELD, N) \
+	((T)->spt.stats.FIELD += (N), vm_stats.FIELD += (N))
+
+/* spt_for_each에 넘기는 콜백. false를 반환하면 순회를 멈춘다.
+ * 콜백 안에서 방문 중인 페이지를 spt_remove_page 해도 된다. */
+typedef bool spt_for_each_func (struct page *page, void *aux);
+
 #include "threads/thread.h"
 void supplemental_page_table_init (struct supplemental_page_table *spt);
 bool supplemental_page_table_copy (struct supplemental_page_table *dst,
@@ -96,6 +224,8 @@ struct page *spt_find_page (struct supplemental_page_table *spt,
 		void *va);
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
+bool spt_for_each (struct supplemental_page_table *spt, void *start, void *end,
+		spt_for_each_func *func, void *aux);
 
 void vm_init (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
@@ -107,6 +237,20 @@ bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
 bool vm_claim_page (void *va);
+void vm_free_frame (struct page *page);
+struct frame *vm_page_frame (struct page *page);
+void vm_frame_io_begin (struct frame *frame);
+void vm_frame_io_end (struct frame *frame);
+struct frame *vm_get_frame (void);
+void frame_share (struct frame *frame, struct page *page);
+void frame_put (struct frame *frame, struct page *page);
+struct frame *vm_frame_at (size_t idx);
+void vm_unmap_begin (void *start, void *end);
+void vm_unmap_end (void);
+bool vm_madvise (void *addr, size_t length, int advice);
+bool vm_populate (void *start, void *end);
+void *vm_sbrk (intptr_t increment);
+void vm_print_stats (void);
 enum vm_type page_get_type (struct page *page);
 
 #endif  /* VM_VM_H */
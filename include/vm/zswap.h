@@ -0,0 +1,18 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+#include <stdbool.h>
+
+struct page;
+
+/* === project3 - Compressed Swap Cache === */
+/* 압축 swap 캐시에 보관된 페이지 하나 */
+struct zswap_entry;
+
+void zswap_init (void);
+bool zswap_store (struct page *page, const void *kva);
+bool zswap_load (struct page *page, void *kva);
+void zswap_copy (struct page *page, void *kva);
+void zswap_free (struct page *page);
+void zswap_print_stats (void);
+
+#endif /* vm/zswap.h */
@@ -0,0 +1,333 @@
+#include <malloc.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+
+/* A user-space malloc(), laid out like the kernel's in
+   threads/malloc.c.
+
+   The size of each request, in bytes, is rounded up to a power
+   of 2 and assigned to the "descriptor" that manages blocks of
+   that size.  The descriptor keeps a list of free blocks.  If
+   the free list is empty, a page of the heap, called an "arena",
+   is divided into blocks, all of which are added to the
+   descriptor's free list.
+
+   Heap pages come from sbrk(), HEAP_CHUNK pages at a time.  The
+   kernel backs them lazily, so pages that are never touched cost
+   nothing.  When an arena has no in-use blocks left, its page
+   goes back on a list of free heap pages that any descriptor can
+   reuse.  If it is the last page handed out, it is returned to
+   the unused tail of the heap instead, and once the tail grows
+   to two chunks, one chunk is given back to the kernel.
+
+   Blocks bigger than 2 kB get their own anonymous mapping, with
+   the number of pages stored in the arena header.  free() unmaps
+   them. */
+
+#define PAGE_SIZE 4096
+
+/* Number of pages to take from sbrk() at once. */
+#define HEAP_CHUNK 16
+
+/* Free block. */
+struct block {
+	struct block *prev;         /* Previous free block of this size. */
+	struct block *next;         /* Next free block of this size. */
+};
+
+/* Descriptor. */
+struct desc {
+	size_t block_size;          /* Size of each element in bytes. */
+	size_t blocks_per_arena;    /* Number of blocks in an arena. */
+	struct block *free_list;    /* List of free blocks. */
+};
+
+/* Magic number for detecting arena corruption. */
+#define ARENA_MAGIC 0x9a548eed
+
+/* Arena. */
+struct arena {
+	unsigned magic;             /* Always set to ARENA_MAGIC. */
+	struct desc *desc;          /* Owning descriptor, null for big block. */
+	size_t free_cnt;            /* Free blocks; pages in big block. */
+};
+
+/* Our set of descriptors. */
+static struct desc descs[10];   /* Descriptors. */
+static size_t desc_cnt;         /* Number of descriptors. */
+
+/* Heap pages. */
+static void *free_pages;        /* Freed heap pages, linked by first word. */
+static uint8_t *heap_next;      /* First heap page not yet handed out. */
+static uint8_t *heap_end;       /* End of the heap we obtained. */
+
+static struct arena *block_to_arena (struct block *);
+static struct block *arena_to_block (struct arena *, size_t idx);
+
+/* Initializes the malloc() descriptors. */
+static void
+malloc_init (void) {
+	size_t block_size;
+
+	for (block_size = 16; block_size < PAGE_SIZE / 2; block_size *= 2) {
+		struct desc *d = &descs[desc_cnt++];
+		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
+		d->block_size = block_size;
+		d->blocks_per_arena = (PAGE_SIZE - sizeof (struct arena)) / block_size;
+		d->free_list = NULL;
+	}
+}
+
+/* Returns a page of the heap, or a null pointer if the heap
+   cannot grow. */
+static void *
+heap_get_page (void) {
+	void *page;
+
+	if (free_pages != NULL) {
+		page = free_pages;
+		free_pages = *(void **) page;
+		return page;
+	}
+
+	if (heap_next == heap_end) {
+		/* Someone else may have moved the break with sbrk(), so
+		   start from the current break, aligned to a page. */
+		uint8_t *brk = sbrk (0);
+		size_t pad = ROUND_UP ((uintptr_t) brk, PAGE_SIZE) - (uintptr_t) brk;
+
+		if (sbrk (pad + HEAP_CHUNK * PAGE_SIZE) == (void *) -1)
+			return NULL;
+		heap_next = brk + pad;
+		heap_end = heap_next + HEAP_CHUNK * PAGE_SIZE;
+	}
+
+	page = heap_next;
+	heap_next += PAGE_SIZE;
+	return page;
+}
+
+/* Gives heap PAGE back. */
+static void
+heap_free_page (void *page) {
+	if ((uint8_t *) page + PAGE_SIZE != heap_next) {
+		*(void **) page = free_pages;
+		free_pages = page;
+		return;
+	}
+
+	heap_next -= PAGE_SIZE;
+	if (heap_end - heap_next >= 2 * HEAP_CHUNK * PAGE_SIZE
+			&& sbrk (0) == heap_end
+			&& sbrk (-HEAP_CHUNK * PAGE_SIZE) != (void *) -1)
+		heap_end -= HEAP_CHUNK * PAGE_SIZE;
+}
+
+/* Adds B to the front of D's free list. */
+static void
+free_list_push (struct desc *d, struct block *b) {
+	b->prev = NULL;
+	b->next = d->free_list;
+	if (d->free_list != NULL)
+		d->free_list->prev = b;
+	d->free_list = b;
+}
+
+/* Removes B from D's free list. */
+static void
+free_list_remove (struct desc *d, struct block *b) {
+	if (b->prev != NULL)
+		b->prev->next = b->next;
+	else
+		d->free_list = b->next;
+	if (b->next != NULL)
+		b->next->prev = b->prev;
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+void *
+malloc (size_t size) {
+	struct desc *d;
+	struct block *b;
+	struct arena *a;
+
+	/* A null pointer satisfies a request for 0 bytes. */
+	if (size == 0)
+		return NULL;
+
+	if (desc_cnt == 0)
+		malloc_init ();
+
+	/* Find the smallest descriptor that satisfies a SIZE-byte
+	   request. */
+	for (d = descs; d < descs + desc_cnt; d++)
+		if (d->block_size >= size)
+			break;
+	if (d == descs + desc_cnt) {
+		/* SIZE is too big for any descriptor.
+		   Map enough pages to hold SIZE plus an arena. */
+		size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PAGE_SIZE);
+		if (page_cnt > SIZE_MAX / PAGE_SIZE)
+			return NULL;
+		a = mmap (NULL, page_cnt * PAGE_SIZE, 1, -1, 0);
+		if (a == MAP_FAILED)
+			return NULL;
+
+		/* Initialize the arena to indicate a big block of PAGE_CNT
+		   pages, and return it. */
+		a->magic = ARENA_MAGIC;
+		a->desc = NULL;
+		a->free_cnt = page_cnt;
+		return a + 1;
+	}
+
+	/* If the free list is empty, create a new arena. */
+	if (d->free_list == NULL) {
+		size_t i;
+
+		/* Allocate a page. */
+		a = heap_get_page ();
+		if (a == NULL)
+			return NULL;
+
+		/* Initialize arena and add its blocks to the free list. */
+		a->magic = ARENA_MAGIC;
+		a->desc = d;
+		a->free_cnt = d->blocks_per_arena;
+		for (i = d->blocks_per_arena; i-- > 0; )
+			free_list_push (d, arena_to_block (a, i));
+	}
+
+	/* Get a block from free list and return it. */
+	b = d->free_list;
+	free_list_remove (d, b);
+	a = block_to_arena (b);
+	a->free_cnt--;
+	return b;
+}
+
+/* Allocates and return A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b) {
+	void *p;
+	size_t size;
+
+	/* Calculate block size and make sure it fits in size_t. */
+	size = a * b;
+	if (b != 0 && size / b != a)
+		return NULL;
+
+	/* Allocate and zero memory. */
+	p = malloc (size);
+	if (p != NULL)
+		memset (p, 0, size);
+
+	return p;
+}
+
+/* Returns the number of bytes allocated for BLOCK. */
+static size_t
+block_size (void *block) {
+	struct block *b = block;
+	struct arena *a = block_to_arena (b);
+	struct desc *d = a->desc;
+
+	return d != NULL ? d->block_size : PAGE_SIZE * a->free_cnt - sizeof *a;
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
+   moving it in the process.
+   If successful, returns the new block; on failure, returns a
+   null pointer.
+   A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+void *
+realloc (void *old_block, size_t new_size) {
+	if (new_size == 0) {
+		free (old_block);
+		return NULL;
+	} else {
+		/* The block already has room to spare. */
+		if (old_block != NULL && new_size <= block_size (old_block))
+			return old_block;
+
+		void *new_block = malloc (new_size);
+		if (old_block != NULL && new_block != NULL) {
+			size_t old_size = block_size (old_block);
+			size_t min_size = new_size < old_size ? new_size : old_size;
+			memcpy (new_block, old_block, min_size);
+			free (old_block);
+		}
+		return new_block;
+	}
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p) {
+	if (p != NULL) {
+		struct block *b = p;
+		struct arena *a = block_to_arena (b);
+		struct desc *d = a->desc;
+
+		if (d != NULL) {
+			/* It's a normal block.  We handle it here. */
+
+#ifndef NDEBUG
+			/* Clear the block to help detect use-after-free bugs. */
+			memset (b, 0xcc, d->block_size);
+#endif
+
+			/* Add block to free list. */
+			free_list_push (d, b);
+
+			/* If the arena is now entirely unused, free it. */
+			if (++a->free_cnt >= d->blocks_per_arena) {
+				size_t i;
+
+				ASSERT (a->free_cnt == d->blocks_per_arena);
+				for (i = 0; i < d->blocks_per_arena; i++)
+					free_list_remove (d, arena_to_block (a, i));
+				heap_free_page (a);
+			}
+		} else {
+			/* It's a big block.  Unmap its pages. */
+			munmap (a);
+		}
+	}
+}
+
+/* Returns the arena that block B is inside. */
+static struct arena *
+block_to_arena (struct block *b) {
+	struct arena *a = (struct arena *) ((uintptr_t) b & ~(PAGE_SIZE - 1));
+	size_t ofs = (uintptr_t) b & (PAGE_SIZE - 1);
+
+	/* Check that the arena is valid. */
+	ASSERT (a != NULL);
+	ASSERT (a->magic == ARENA_MAGIC);
+
+	/* Check that the block is properly aligned for the arena. */
+	ASSERT (a->desc == NULL
+			|| (ofs - sizeof *a) % a->desc->block_size == 0);
+	ASSERT (a->desc != NULL || ofs == sizeof *a);
+
+	return a;
+}
+
+/* Returns the (IDX - 1)'th block within arena A. */
+static struct block *
+arena_to_block (struct arena *a, size_t idx) {
+	ASSERT (a != NULL);
+	ASSERT (a->magic == ARENA_MAGIC);
+	ASSERT (idx < a->desc->blocks_per_arena);
+	return (struct block *) ((uint8_t *) a
+			+ sizeof *a
+			+ idx * a->desc->block_size);
+}
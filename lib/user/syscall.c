@@ -68,6 +68,18 @@ static __inline int64_t syscall (uint64_t num_, uint64_t a1_, uint64_t a2_,
 			((uint64_t) ARG3), \
 			((uint64_t) ARG4), \
 			0))
+
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2,
+   ARG3, ARG4, and ARG5, and returns the return value as an
+   `int'. */
+#define syscall6(NUMBER, ARG0, ARG1, ARG2, ARG3, ARG4, ARG5) ( \
+		syscall(((uint64_t) NUMBER), \
+			((uint64_t) ARG0), \
+			((uint64_t) ARG1), \
+			((uint64_t) ARG2), \
+			((uint64_t) ARG3), \
+			((uint64_t) ARG4), \
+			((uint64_t) ARG5)))
 void
 halt (void) {
 	syscall0 (SYS_HALT);
@@ -147,7 +159,14 @@ dup2 (int oldfd, int newfd){
 
 void *
 mmap (void *addr, size_t length, int writable, int fd, off_t offset) {
-	return (void *) syscall5 (SYS_MMAP, addr, length, writable, fd, offset);
+	return mmap_flags (addr, length, writable, fd, offset, 0);
+}
+
+void *
+mmap_flags (void *addr, size_t length, int writable, int fd, off_t offset,
+		int flags) {
+	return (void *) syscall6 (SYS_MMAP, addr, length, writable, fd, offset,
+			flags);
 }
 
 void
@@ -155,6 +174,26 @@ munmap (void *addr) {
 	syscall1 (SYS_MUNMAP, addr);
 }
 
+bool
+vmstat (bool global, struct vm_stats *stats) {
+	return syscall2 (SYS_VMSTAT, global, stats);
+}
+
+int
+madvise (void *addr, size_t length, int advice) {
+	return syscall3 (SYS_MADVISE, addr, length, advice);
+}
+
+int
+prefault (void *addr, size_t length) {
+	return syscall2 (SYS_PREFAULT, addr, length);
+}
+
+void *
+sbrk (intptr_t increment) {
+	return (void *) syscall1 (SYS_SBRK, increment);
+}
+
 bool
 chdir (const char *dir) {
 	return syscall1 (SYS_CHDIR, dir);
@@ -0,0 +1,47 @@
+/* Forks with a buffer larger than physical memory, so that frames
+ * still shared between the parent and the child have to be evicted.
+ * The child overwrites every other page, then both processes check
+ * that they see their own contents. */
+
+#include <string.h>
+#include <syscall.h>
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define ONE_MB (1 << 20)
+#define CHUNK_SIZE (6 * ONE_MB)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+
+static char big_chunk[CHUNK_SIZE];
+
+void
+test_main (void)
+{
+	pid_t child;
+	size_t i;
+
+	for (i = 0; i < PAGE_COUNT; i++)
+		big_chunk[i * PAGE_SIZE] = (char) i;
+	msg ("filled %d pages", PAGE_COUNT);
+
+	child = fork ("child");
+	if (child == 0) {
+		for (i = 0; i < PAGE_COUNT; i += 2)
+			big_chunk[i * PAGE_SIZE] = (char) ~i;
+		for (i = 0; i < PAGE_COUNT; i++) {
+			char expected = i % 2 == 0 ? (char) ~i : (char) i;
+			if (big_chunk[i * PAGE_SIZE] != expected)
+				fail ("child: page %zu is inconsistent", i);
+		}
+		msg ("child: contents consistent");
+		exit (0);
+	}
+	wait (child);
+
+	for (i = 0; i < PAGE_COUNT; i++)
+		if (big_chunk[i * PAGE_SIZE] != (char) i)
+			fail ("parent: page %zu is inconsistent", i);
+	msg ("parent: contents consistent");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cow-evict) begin
+(cow-evict) filled 1536 pages
+(cow-evict) child: contents consistent
+(cow-evict) parent: contents consistent
+(cow-evict) end
+EOF
+pass;
@@ -0,0 +1,60 @@
+/* Checks that writes after fork stay private to the writer,
+ * in both directions. Each page of the buffer starts out shared
+ * between the parent and the child. */
+
+#include <string.h>
+#include <syscall.h>
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_COUNT 16
+
+static char buf[PAGE_COUNT * PAGE_SIZE];
+
+/* Returns true if every page of BUF starts with the byte PAGE + BIAS. */
+static bool
+check_pages (int bias)
+{
+	for (size_t i = 0; i < PAGE_COUNT; i++)
+		if (buf[i * PAGE_SIZE] != (char) (i + bias))
+			return false;
+	return true;
+}
+
+static void
+fill_pages (int bias)
+{
+	for (size_t i = 0; i < PAGE_COUNT; i++)
+		buf[i * PAGE_SIZE] = (char) (i + bias);
+}
+
+void
+test_main (void)
+{
+	pid_t child;
+
+	fill_pages (0);
+
+	/* The child writes; the parent must not see it. */
+	child = fork ("child-write");
+	if (child == 0) {
+		fill_pages (1);
+		CHECK (check_pages (1), "child sees its own writes");
+		exit (0);
+	}
+	wait (child);
+	CHECK (check_pages (0), "parent keeps its data after child writes");
+
+	/* The parent writes; the child must not see it, whether it
+	 * runs before or after the write. */
+	child = fork ("child-read");
+	if (child == 0) {
+		CHECK (check_pages (0), "child keeps its data after parent writes");
+		exit (0);
+	}
+	fill_pages (2);
+	wait (child);
+	CHECK (check_pages (2), "parent sees its own writes");
+}
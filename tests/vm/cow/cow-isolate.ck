@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cow-isolate) begin
+(cow-isolate) child sees its own writes
+(cow-isolate) parent keeps its data after child writes
+(cow-isolate) child keeps its data after parent writes
+(cow-isolate) parent sees its own writes
+(cow-isolate) end
+EOF
+pass;
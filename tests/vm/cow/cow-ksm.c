@@ -0,0 +1,63 @@
+/* Fills pages with identical contents and waits for ksmd to merge
+ * them. Then writes every other merged page, pushes the buffer out
+ * to swap by touching more memory than fits, and checks that every
+ * page still holds what was last written to it. */
+
+#include <string.h>
+#include <syscall.h>
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define ONE_MB (1 << 20)
+#define PAGE_COUNT 64
+#define CHUNK_SIZE (6 * ONE_MB)
+
+static char buf[PAGE_COUNT * PAGE_SIZE];
+static char big_chunk[CHUNK_SIZE];
+
+/* Returns true if page I of BUF is filled with byte C. */
+static bool
+page_filled (size_t i, char c)
+{
+	for (size_t j = 0; j < PAGE_SIZE; j++)
+		if (buf[i * PAGE_SIZE + j] != c)
+			return false;
+	return true;
+}
+
+void
+test_main (void)
+{
+	struct vm_stats stats;
+	size_t i;
+
+	memset (buf, 'k', sizeof buf);
+
+	/* ksmd only merges pages whose contents stayed the same over a
+	 * whole scan, so this takes a couple of its wakeups. */
+	do
+		if (!vmstat (false, &stats))
+			fail ("vmstat");
+	while (stats.ksm_merges < PAGE_COUNT - 1);
+	msg ("pages merged");
+
+	for (i = 1; i < PAGE_COUNT; i++)
+		if (get_phys_addr (buf + i * PAGE_SIZE)
+				== get_phys_addr (buf + (i - 1) * PAGE_SIZE))
+			break;
+	CHECK (i < PAGE_COUNT, "merged pages share a frame");
+
+	for (i = 0; i < PAGE_COUNT; i += 2)
+		memset (buf + i * PAGE_SIZE, (char) i, PAGE_SIZE);
+
+	for (i = 0; i < CHUNK_SIZE; i += PAGE_SIZE)
+		big_chunk[i] = (char) i;
+	msg ("touched %d pages", CHUNK_SIZE / PAGE_SIZE);
+
+	for (i = 0; i < PAGE_COUNT; i++)
+		if (!page_filled (i, i % 2 == 0 ? (char) i : 'k'))
+			fail ("page %zu is inconsistent", i);
+	msg ("contents consistent");
+}
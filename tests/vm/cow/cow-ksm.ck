@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cow-ksm) begin
+(cow-ksm) pages merged
+(cow-ksm) merged pages share a frame
+(cow-ksm) touched 1536 pages
+(cow-ksm) contents consistent
+(cow-ksm) end
+EOF
+pass;
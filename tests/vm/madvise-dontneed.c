@@ -0,0 +1,38 @@
+/* Checks that MADV_DONTNEED drops a page's contents: a page of the
+ * data segment goes back to what the executable holds, and an
+ * anonymous mapping goes back to zeros. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+
+/* Alone on its page, so that dropping it does not also reset the
+ * other initialized data of the program. */
+static char data_page[PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)))
+	= "madvise dontneed";
+
+void
+test_main (void)
+{
+	char *anon;
+
+	memset (data_page, 'x', PAGE_SIZE);
+	CHECK (madvise (data_page, PAGE_SIZE, MADV_DONTNEED) == 0,
+			"madvise data page");
+	CHECK (!strcmp (data_page, "madvise dontneed"),
+			"data page is read back from the executable");
+
+	CHECK ((anon = mmap (NULL, PAGE_SIZE, true, -1, 0)) != MAP_FAILED,
+			"mmap anonymous page");
+	memset (anon, 'x', PAGE_SIZE);
+	CHECK (madvise (anon, PAGE_SIZE, MADV_DONTNEED) == 0,
+			"madvise anonymous page");
+	for (size_t i = 0; i < PAGE_SIZE; i++)
+		if (anon[i] != 0)
+			fail ("byte %zu of the anonymous page is not zero", i);
+	msg ("anonymous page is zero-filled");
+	munmap (anon);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise-dontneed) begin
+(madvise-dontneed) madvise data page
+(madvise-dontneed) data page is read back from the executable
+(madvise-dontneed) mmap anonymous page
+(madvise-dontneed) madvise anonymous page
+(madvise-dontneed) anonymous page is zero-filled
+(madvise-dontneed) end
+EOF
+pass;
@@ -0,0 +1,98 @@
+/* Exercises the user-space malloc() on both sides of its 2 kB
+   threshold: small blocks come from heap arenas, bigger ones from
+   their own anonymous mappings.  realloc() moves a block across
+   the threshold in both directions and must keep its contents. */
+
+#include <malloc.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_CNT 64
+
+/* Fills the SIZE bytes at P with a pattern derived from SEED. */
+static void
+fill (char *p, size_t size, int seed)
+{
+  for (size_t i = 0; i < size; i++)
+    p[i] = (char) (seed + i % 251);
+}
+
+/* Returns true if the SIZE bytes at P hold the pattern of SEED. */
+static bool
+check (const char *p, size_t size, int seed)
+{
+  for (size_t i = 0; i < size; i++)
+    if (p[i] != (char) (seed + i % 251))
+      return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  static const size_t sizes[] = {16, 100, 1000, 2048, 2049, 5000, 20000};
+  const size_t size_cnt = sizeof sizes / sizeof *sizes;
+  char *blocks[BLOCK_CNT];
+  char *p;
+  size_t i;
+
+  /* Many live blocks of mixed sizes must not overlap. */
+  for (i = 0; i < BLOCK_CNT; i++)
+    {
+      blocks[i] = malloc (sizes[i % size_cnt]);
+      if (blocks[i] == NULL)
+        fail ("malloc (%zu) failed", sizes[i % size_cnt]);
+      fill (blocks[i], sizes[i % size_cnt], i);
+    }
+  for (i = 0; i < BLOCK_CNT; i++)
+    if (!check (blocks[i], sizes[i % size_cnt], i))
+      fail ("block %zu was overwritten", i);
+  msg ("mixed-size blocks are intact");
+
+  /* Free every other block and allocate again into the holes. */
+  for (i = 0; i < BLOCK_CNT; i += 2)
+    free (blocks[i]);
+  for (i = 0; i < BLOCK_CNT; i += 2)
+    {
+      blocks[i] = malloc (sizes[i % size_cnt]);
+      if (blocks[i] == NULL)
+        fail ("malloc (%zu) failed", sizes[i % size_cnt]);
+      fill (blocks[i], sizes[i % size_cnt], i);
+    }
+  for (i = 0; i < BLOCK_CNT; i++)
+    if (!check (blocks[i], sizes[i % size_cnt], i))
+      fail ("block %zu was overwritten", i);
+  msg ("blocks reused after free are intact");
+  for (i = 0; i < BLOCK_CNT; i++)
+    free (blocks[i]);
+
+  /* Grow one block from the smallest class to a big block and
+     shrink it back, checking its contents after every move. */
+  p = malloc (16);
+  fill (p, 16, 7);
+  for (i = 1; i < size_cnt; i++)
+    {
+      p = realloc (p, sizes[i]);
+      if (p == NULL || !check (p, sizes[i - 1], 7))
+        fail ("realloc up to %zu lost data", sizes[i]);
+      fill (p, sizes[i], 7);
+    }
+  msg ("realloc up across 2 kB keeps data");
+  for (i = size_cnt - 1; i-- > 0; )
+    {
+      p = realloc (p, sizes[i]);
+      if (p == NULL || !check (p, sizes[i], 7))
+        fail ("realloc down to %zu lost data", sizes[i]);
+    }
+  msg ("realloc down across 2 kB keeps data");
+  CHECK (realloc (p, 0) == NULL, "realloc to 0 frees the block");
+
+  p = calloc (3000, 1);
+  for (i = 0; i < 3000; i++)
+    if (p[i] != 0)
+      fail ("calloc byte %zu is not zero", i);
+  free (p);
+  msg ("calloc of a big block is zeroed");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(malloc-realloc) begin
+(malloc-realloc) mixed-size blocks are intact
+(malloc-realloc) blocks reused after free are intact
+(malloc-realloc) realloc up across 2 kB keeps data
+(malloc-realloc) realloc down across 2 kB keeps data
+(malloc-realloc) realloc to 0 frees the block
+(malloc-realloc) calloc of a big block is zeroed
+(malloc-realloc) end
+EOF
+pass;
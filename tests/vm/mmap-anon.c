@@ -0,0 +1,36 @@
+/* Maps anonymous memory with mmap(fd = -1), checks that it starts
+   out zeroed and keeps what is written, then unmaps it and
+   verifies that the region is inaccessible afterward. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 4
+
+void
+test_main (void)
+{
+  char *map;
+  size_t i;
+
+  CHECK ((map = mmap (NULL, PAGE_CNT * PAGE_SIZE, 1, -1, 0)) != MAP_FAILED,
+         "mmap anonymous memory");
+  for (i = 0; i < PAGE_CNT * PAGE_SIZE; i++)
+    if (map[i] != 0)
+      fail ("byte %zu is not zero", i);
+  msg ("mapping is zero-filled");
+
+  for (i = 0; i < PAGE_CNT; i++)
+    memset (map + i * PAGE_SIZE, 'a' + i, PAGE_SIZE);
+  for (i = 0; i < PAGE_CNT * PAGE_SIZE; i++)
+    if (map[i] != (char) ('a' + i / PAGE_SIZE))
+      fail ("byte %zu does not hold what was written", i);
+  msg ("mapping keeps written data");
+
+  munmap (map);
+
+  fail ("unmapped memory is readable (%d)", map[PAGE_SIZE]);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(mmap-anon) begin
+(mmap-anon) mmap anonymous memory
+(mmap-anon) mapping is zero-filled
+(mmap-anon) mapping keeps written data
+mmap-anon: exit(-1)
+EOF
+pass;
@@ -0,0 +1,51 @@
+/* Checks that read()/write() and a mapping of the same file see a
+   single copy of its contents: data written with write() shows up
+   in a mapping made earlier, and data stored through the mapping
+   is returned by read() before the file is unmapped. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((char *) 0x10000000)
+#define FROM_WRITE_OFS 16
+#define FROM_MAP_OFS 512
+
+void
+test_main (void)
+{
+  static const char from_write[] = "written with write()";
+  static const char from_map[] = "stored through the mapping";
+  int handle;
+  void *map;
+  char buf[sizeof from_map];
+
+  CHECK (create ("coherent.txt", strlen (sample)), "create \"coherent.txt\"");
+  CHECK ((handle = open ("coherent.txt")) > 1, "open \"coherent.txt\"");
+  CHECK (write (handle, sample, strlen (sample)) == (int) strlen (sample),
+         "write \"coherent.txt\"");
+  CHECK ((map = mmap (ACTUAL, strlen (sample), 1, handle, 0)) != MAP_FAILED,
+         "mmap \"coherent.txt\"");
+  CHECK (!memcmp (ACTUAL, sample, strlen (sample)),
+         "mapping holds the file's contents");
+
+  /* write() -> mapping. */
+  seek (handle, FROM_WRITE_OFS);
+  CHECK (write (handle, from_write, sizeof from_write)
+         == (int) sizeof from_write, "write() into the mapped file");
+  CHECK (!memcmp (ACTUAL + FROM_WRITE_OFS, from_write, sizeof from_write),
+         "mapping sees data from write()");
+
+  /* Mapping -> read(). */
+  memcpy (ACTUAL + FROM_MAP_OFS, from_map, sizeof from_map);
+  seek (handle, FROM_MAP_OFS);
+  CHECK (read (handle, buf, sizeof buf) == (int) sizeof buf,
+         "read() from the mapped file");
+  CHECK (!memcmp (buf, from_map, sizeof from_map),
+         "read() sees data stored through the mapping");
+
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-coherent) begin
+(mmap-coherent) create "coherent.txt"
+(mmap-coherent) open "coherent.txt"
+(mmap-coherent) write "coherent.txt"
+(mmap-coherent) mmap "coherent.txt"
+(mmap-coherent) mapping holds the file's contents
+(mmap-coherent) write() into the mapped file
+(mmap-coherent) mapping sees data from write()
+(mmap-coherent) read() from the mapped file
+(mmap-coherent) read() sees data stored through the mapping
+(mmap-coherent) end
+EOF
+pass;
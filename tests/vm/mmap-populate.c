@@ -0,0 +1,51 @@
+/* Checks that MAP_POPULATE and prefault() load pages up front:
+   touching them afterwards must not fault.  Also checks that
+   mmap_flags() rejects unknown flags. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define FILE_MAP ((char *) 0x10000000)
+#define ANON_PAGES 8
+
+/* Returns the number of page faults this process has taken. */
+static long long
+fault_cnt (void)
+{
+  struct vm_stats stats;
+
+  if (!vmstat (false, &stats))
+    fail ("vmstat");
+  return stats.faults;
+}
+
+void
+test_main (void)
+{
+  long long faults;
+  char *anon;
+  int handle;
+  size_t i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (mmap_flags (FILE_MAP, PAGE_SIZE, 0, handle, 0, 0x80) == MAP_FAILED,
+         "mmap with an unknown flag fails");
+  CHECK (mmap_flags (FILE_MAP, PAGE_SIZE, 0, handle, 0, MAP_POPULATE)
+         != MAP_FAILED, "mmap \"sample.txt\" with MAP_POPULATE");
+  faults = fault_cnt ();
+  if (memcmp (FILE_MAP, sample, strlen (sample)))
+    fail ("read of mapped file is incorrect");
+  CHECK (fault_cnt () == faults, "populated mapping does not fault");
+
+  CHECK ((anon = mmap (NULL, ANON_PAGES * PAGE_SIZE, 1, -1, 0)) != MAP_FAILED,
+         "mmap anonymous memory");
+  CHECK (prefault (anon, ANON_PAGES * PAGE_SIZE) == 0, "prefault it");
+  faults = fault_cnt ();
+  for (i = 0; i < ANON_PAGES; i++)
+    anon[i * PAGE_SIZE] = 'p';
+  CHECK (fault_cnt () == faults, "prefaulted pages do not fault");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-populate) begin
+(mmap-populate) open "sample.txt"
+(mmap-populate) mmap with an unknown flag fails
+(mmap-populate) mmap "sample.txt" with MAP_POPULATE
+(mmap-populate) populated mapping does not fault
+(mmap-populate) mmap anonymous memory
+(mmap-populate) prefault it
+(mmap-populate) prefaulted pages do not fault
+(mmap-populate) end
+EOF
+pass;
@@ -0,0 +1,48 @@
+/* Grows the heap with sbrk(), shrinks it again, and checks that
+   pages given back are zero when the heap grows over them again
+   and inaccessible while it does not. */
+
+#include <string.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+
+void
+test_main (void)
+{
+  uint8_t *base, *brk;
+  size_t i;
+
+  /* Start on a page boundary, so that whole pages are returned. */
+  brk = sbrk (0);
+  CHECK (sbrk ((PAGE_SIZE - (uintptr_t) brk % PAGE_SIZE) % PAGE_SIZE)
+         != (void *) -1, "align the break");
+  base = sbrk (0);
+
+  CHECK (sbrk (4 * PAGE_SIZE) == base, "grow the heap by 4 pages");
+  CHECK (sbrk (0) == base + 4 * PAGE_SIZE, "break moved up");
+  for (i = 0; i < 4 * PAGE_SIZE; i++)
+    if (base[i] != 0)
+      fail ("new heap byte %zu is not zero", i);
+  memset (base, 'h', 4 * PAGE_SIZE);
+
+  CHECK (sbrk (-3 * PAGE_SIZE) == base + 4 * PAGE_SIZE,
+         "shrink the heap by 3 pages");
+  CHECK (sbrk (0) == base + PAGE_SIZE, "break moved down");
+  CHECK (base[PAGE_SIZE - 1] == 'h', "remaining page keeps its data");
+
+  CHECK (sbrk (PAGE_SIZE) == base + PAGE_SIZE, "grow again by 1 page");
+  for (i = PAGE_SIZE; i < 2 * PAGE_SIZE; i++)
+    if (base[i] != 0)
+      fail ("regrown heap byte %zu is not zero", i);
+  msg ("regrown page is zero");
+
+  CHECK (sbrk (-0x10000000) == (void *) -1,
+         "shrinking below the heap start fails");
+
+  CHECK (sbrk (-PAGE_SIZE) == base + 2 * PAGE_SIZE, "shrink again");
+  fail ("freed heap page is readable (%d)", base[PAGE_SIZE]);
+}
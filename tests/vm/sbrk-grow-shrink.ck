@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sbrk-grow-shrink) begin
+(sbrk-grow-shrink) align the break
+(sbrk-grow-shrink) grow the heap by 4 pages
+(sbrk-grow-shrink) break moved up
+(sbrk-grow-shrink) shrink the heap by 3 pages
+(sbrk-grow-shrink) break moved down
+(sbrk-grow-shrink) remaining page keeps its data
+(sbrk-grow-shrink) grow again by 1 page
+(sbrk-grow-shrink) regrown page is zero
+(sbrk-grow-shrink) shrinking below the heap start fails
+(sbrk-grow-shrink) shrink again
+sbrk-grow-shrink: exit(-1)
+EOF
+pass;
@@ -0,0 +1,61 @@
+/* Checks swapping with WSClock eviction ("-wsclock") in 10 MB of
+ * memory. A clean file mapping gives the clock pages it can drop
+ * without writing, and the anonymous buffer is written twice, so
+ * pages the cleaner already wrote to swap are dirtied again and must
+ * be written once more before they are evicted. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/large.inc"
+
+#define PAGE_SIZE 4096
+#define ONE_MB (1 << 20)
+#define CHUNK_SIZE (20 * ONE_MB)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+
+static char big_chunks[CHUNK_SIZE];
+
+/* Writes values derived from ROUND into the first and last byte of
+   every page of the buffer, reads the file mapped at ACTUAL, then
+   checks the buffer. */
+static void
+run_round (int round, const char *actual)
+{
+	size_t i;
+
+	for (i = 0; i < PAGE_COUNT; i++) {
+		big_chunks[i * PAGE_SIZE] = (char) (i + round);
+		big_chunks[i * PAGE_SIZE + PAGE_SIZE - 1] = (char) (i * round);
+	}
+	msg ("round %d: wrote %d pages", round, PAGE_COUNT);
+
+	if (memcmp (actual, large, strlen (large)))
+		fail ("round %d: read of mmap'd file reported bad data", round);
+
+	for (i = 0; i < PAGE_COUNT; i++)
+		if (big_chunks[i * PAGE_SIZE] != (char) (i + round)
+				|| big_chunks[i * PAGE_SIZE + PAGE_SIZE - 1]
+					!= (char) (i * round))
+			fail ("round %d: page %zu is inconsistent", round, i);
+	msg ("round %d: contents consistent", round);
+}
+
+void
+test_main (void)
+{
+	char *actual = (char *) 0x10000000;
+	int handle;
+	void *map;
+
+	CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+	CHECK ((map = mmap (actual, sizeof large, 0, handle, 0)) != MAP_FAILED,
+			"mmap \"large.txt\"");
+
+	run_round (1, actual);
+	run_round (2, actual);
+
+	munmap (map);
+	close (handle);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(swap-wsclock) begin
+(swap-wsclock) open "large.txt"
+(swap-wsclock) mmap "large.txt"
+(swap-wsclock) round 1: wrote 5120 pages
+(swap-wsclock) round 1: contents consistent
+(swap-wsclock) round 2: wrote 5120 pages
+(swap-wsclock) round 2: contents consistent
+(swap-wsclock) end
+EOF
+pass;
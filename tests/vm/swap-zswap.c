@@ -0,0 +1,71 @@
+/* Checks that anonymous pages survive the compressed swap cache.
+ * Pintos runs with 10 MB of memory and "-zswap". The buffer mixes
+ * pages filled with one repeated byte, pages that compress well and
+ * pages of noise that do not, so swap-out goes through the same-filled
+ * entries, the compressor and the arena, and straight to disk. There
+ * are far more compressible pages than the arena holds, so older
+ * entries spill to the swap disk too. Every page is checked in full. */
+
+#include <string.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define ONE_MB (1 << 20)
+#define CHUNK_SIZE (20 * ONE_MB)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+
+static uint8_t big_chunks[CHUNK_SIZE];
+static uint8_t expected[PAGE_SIZE];
+
+/* Fills P with the contents of page I. */
+static void
+fill_page (size_t i, uint8_t *p)
+{
+	uint32_t seed = i * 2654435761u + 1;
+	size_t noise;
+
+	switch (i % 3) {
+		case 0:
+			/* Same-filled. */
+			memset (p, (int) i, PAGE_SIZE);
+			return;
+		case 1:
+			/* Compresses to a bit more than half a page. */
+			noise = PAGE_SIZE / 2;
+			break;
+		default:
+			/* Does not compress. */
+			noise = PAGE_SIZE;
+			break;
+	}
+
+	for (size_t j = 0; j < noise; j++) {
+		seed = seed * 1103515245 + 12345;
+		p[j] = seed >> 16;
+	}
+	for (size_t j = noise; j < PAGE_SIZE; j++)
+		p[j] = (uint8_t) (i + j % 8);
+}
+
+void
+test_main (void)
+{
+	size_t i;
+
+	for (i = 0; i < PAGE_COUNT; i++) {
+		if (i % 512 == 0)
+			msg ("write page %zu", i);
+		fill_page (i, big_chunks + i * PAGE_SIZE);
+	}
+
+	for (i = 0; i < PAGE_COUNT; i++) {
+		fill_page (i, expected);
+		if (memcmp (big_chunks + i * PAGE_SIZE, expected, PAGE_SIZE))
+			fail ("page %zu is inconsistent", i);
+		if (i % 512 == 0)
+			msg ("check page %zu", i);
+	}
+}
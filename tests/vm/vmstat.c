@@ -0,0 +1,35 @@
+/* Checks the counters reported by vmstat(): touching new pages
+   must show up as faults and resident pages, the system-wide
+   counters must cover this process's, and a buffer that is not
+   writable must get the process killed. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 16
+
+static char pages[PAGE_CNT * PAGE_SIZE];
+
+void
+test_main (void)
+{
+  struct vm_stats before, after, global;
+  size_t i;
+
+  CHECK (vmstat (false, &before), "vmstat before touching pages");
+  for (i = 0; i < PAGE_CNT; i++)
+    pages[i * PAGE_SIZE] = 1;
+  CHECK (vmstat (false, &after), "vmstat after touching pages");
+
+  CHECK (after.faults > before.faults, "faults went up");
+  CHECK (after.rss >= before.rss + PAGE_CNT, "resident pages went up");
+  CHECK (after.peak_rss >= after.rss, "peak is at least the current RSS");
+
+  CHECK (vmstat (true, &global), "vmstat for the whole system");
+  CHECK (global.faults >= after.faults, "system faults cover ours");
+
+  vmstat (false, (struct vm_stats *) test_main);
+  fail ("vmstat wrote into code");
+}
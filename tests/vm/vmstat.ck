@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(vmstat) begin
+(vmstat) vmstat before touching pages
+(vmstat) vmstat after touching pages
+(vmstat) faults went up
+(vmstat) resident pages went up
+(vmstat) peak is at least the current RSS
+(vmstat) vmstat for the whole system
+(vmstat) system faults cover ours
+vmstat: exit(-1)
+EOF
+pass;
@@ -165,6 +165,7 @@ paging_init (uint64_t mem_end) {
 
 	// reload cr3
 	pml4_activate(0);
+	pcid_init ();
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -221,9 +222,26 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-tickless"))
+			timer_tickless = true;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
+#ifdef VM
+		else if (!strcmp (name, "-wsclock"))
+			vm_wsclock = true;
+		else if (!strcmp (name, "-zswap"))
+			vm_zswap = true;
+		else if (!strcmp (name, "-nohuge"))
+			vm_huge_pages = false;
+		else if (!strcmp (name, "-ksm"))
+			vm_ksm = atoi (value);
+		else if (!strcmp (name, "-fa")) {
+			vm_fault_around = atoi (value);
+			if (vm_fault_around > FAULT_AROUND_MAX)
+				vm_fault_around = FAULT_AROUND_MAX;
+		}
+#endif
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
 #endif
@@ -326,8 +344,16 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -tickless          Stop the periodic timer while idle.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+			"  -wsclock           Evict with dirty-aware WSClock.\n"
+			"  -zswap             Compress swapped pages in memory first.\n"
+			"  -nohuge            Do not map large regions with 2 MB pages.\n"
+			"  -fa=PAGES          Populate PAGES more pages on file faults.\n"
+			"  -ksm=PAGES         Merge identical pages, scanning PAGES per 100 ms.\n"
 #endif
 			);
 	power_off ();
@@ -356,6 +382,9 @@ print_stats (void) {
 	thread_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
+#endif
+#ifdef VM
+	vm_print_stats ();
 #endif
 	console_print_stats ();
 	kbd_print_stats ();
@@ -344,6 +344,14 @@ intr_handler (struct intr_frame *frame) {
 
 		in_external_intr = true;
 		yield_on_return = false;
+
+		//==================================================================
+		//				Project 1 - Tickless Idle
+		//------------------------------------------------------------------
+		// idle 중에 다른 장치가 깨웠으면 멈춰 있던 tick부터 채운다.
+		if (frame->vec_no != 0x20)
+			timer_idle_exit ();
+		//==================================================================
 	}
 
 	/* Invoke the interrupt's handler. */
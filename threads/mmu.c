@@ -2,18 +2,50 @@
 #include <stddef.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* Replaces the 2 MB mapping in *PDE by a page table of 4 kB
+ * mappings to the same frames with the same flags, so that single
+ * pages in it can be changed.  A cleared mapping splits into
+ * cleared entries that keep its accessed and dirty bits.
+ * Returns false, leaving *PDE unchanged, if no page table can be
+ * allocated.  No TLB flush is needed: the translations do not
+ * change, and changing a page afterwards flushes it with invlpg,
+ * which also drops the large TLB entry covering it. */
+static bool
+pde_split (uint64_t *pde) {
+	uint64_t *pt = palloc_get_page (0);
+	uint64_t pa = PTE_ADDR (*pde);
+	uint64_t flags = *pde & PTE_FLAGS & ~PTE_PS;
+
+	if (pt == NULL)
+		return false;
+	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
+		pt[i] = (pa + i * PGSIZE) | flags;
+	*pde = vtop (pt) | PTE_U | PTE_W | PTE_P;
+	return true;
+}
+
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
 	if (pdp) {
 		uint64_t *pte = (uint64_t *) pdp[idx];
-		if (!((uint64_t) pte & PTE_P)) {
+		if ((uint64_t) pte & PTE_PS) {
+			/* A 2 MB mapping is its own leaf, also once it has been
+			 * cleared, so that its dirty bit can still be read.
+			 * Return it for lookups, but split it when a 4 kB entry
+			 * is asked for. */
+			if (!create)
+				return &pdp[idx];
+			if (!pde_split (&pdp[idx]))
+				return NULL;
+		} else if (!((uint64_t) pte & PTE_P)) {
 			if (create) {
 				uint64_t *new_page = palloc_get_page (PAL_ZERO);
 				if (new_page)
@@ -88,6 +120,43 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 	return pte;
 }
 
+/* Returns the address of the page directory entry for virtual
+ * address VA in PML4.  Missing upper-level tables are created if
+ * CREATE is true, otherwise a null pointer is returned. */
+static uint64_t *
+pde_walk (uint64_t *pml4, const uint64_t va, int create) {
+	uint64_t *table = pml4;
+	unsigned idx[] = { PML4 (va), PDPE (va) };
+
+	for (unsigned level = 0; level < 2; level++) {
+		uint64_t *entry = &table[idx[level]];
+		if (!(*entry & PTE_P)) {
+			if (!create)
+				return NULL;
+			uint64_t *new_page = palloc_get_page (PAL_ZERO);
+			if (new_page == NULL)
+				return NULL;
+			*entry = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+		}
+		table = ptov (PTE_ADDR (*entry));
+	}
+	return &table[PDX (va)];
+}
+
+/* Like pml4e_walk() without CREATE, but a 2 MB mapping covering
+ * VA is first split, so that the returned entry maps only VA.
+ * Returns a null pointer if the split fails. */
+static uint64_t *
+pml4e_walk_small (uint64_t *pml4, const uint64_t va) {
+	uint64_t *pte = pml4e_walk (pml4, va, false);
+	if (pte != NULL && (*pte & PTE_PS)) {
+		if (!pde_split (pte))
+			return NULL;
+		pte = pml4e_walk (pml4, va, false);
+	}
+	return pte;
+}
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
@@ -122,7 +191,9 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		/* 2 MB mappings are only made by the VM, which does not
+		 * walk page tables this way. */
+		if ((((uint64_t) pte) & PTE_P) && !(((uint64_t) pte) & PTE_PS))
 			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
 				return false;
@@ -169,7 +240,8 @@ static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		/* The frames behind a 2 MB mapping belong to the VM. */
+		if ((((uint64_t) pte) & PTE_P) && !(((uint64_t) pte) & PTE_PS))
 			pt_destroy (PTE_ADDR (pte));
 	}
 	palloc_free_page ((void *) pdp);
@@ -199,11 +271,112 @@ pml4_destroy (uint64_t *pml4) {
 	palloc_free_page ((void *) pml4);
 }
 
+/* Process-context identifiers (PCIDs).
+ *
+ * With CR4.PCIDE set, TLB entries are tagged with the PCID in the
+ * low 12 bits of CR3, and a CR3 write with CR3_NOFLUSH keeps them.
+ * Each pml4 gets its own PCID on first activation, so switching
+ * between processes no longer flushes the TLB.
+ *
+ * PCIDs are handed out in increasing order.  When all 4095 are used
+ * up, a new generation starts: the whole TLB is flushed and every
+ * pml4 gets a fresh PCID the next time it is activated.  Within a
+ * generation a PCID is never reused, so a dead address space cannot
+ * leave entries that a new one would hit.
+ *
+ * The PCID of a pml4 lives in its last entry, which is never used
+ * for translation: user space is below KERN_BASE and the kernel is
+ * mapped by entry PML4 (KERN_BASE).  The entry is kept not present,
+ * so the CPU ignores the other bits. */
+#define PML4_PCID_SLOT 511
+#define PCID_STALE 0x2                  /* Flush on next activation. */
+#define PCID_SHIFT 12                   /* Bits 12:23 hold the PCID. */
+#define PCID_MASK 0xfff
+#define PCID_GEN_SHIFT 32               /* Bits 32:63 hold the generation. */
+
+#define CR3_NOFLUSH (1ULL << 63)        /* Keep TLB entries of the PCID. */
+#define CR4_PGE (1 << 7)                /* Global pages. */
+#define CR4_PCIDE (1 << 17)             /* PCIDs enabled. */
+#define CPUID_1_ECX_PCID (1 << 17)      /* CPU supports PCIDs. */
+
+static bool pcid_enabled;
+static uint64_t pcid_gen = 1;
+static uint64_t pcid_next = 1;
+
+/* Enables PCIDs if the CPU supports them.  Must be called while
+ * base_pml4 is active with PCID 0. */
+void
+pcid_init (void) {
+	if (!(cpuid_ecx (1) & CPUID_1_ECX_PCID))
+		return;
+
+	ASSERT ((rcr3 () & PCID_MASK) == 0);
+	lcr4 (rcr4 () | CR4_PCIDE);
+	pcid_enabled = true;
+}
+
+/* Returns true if PML4 is the active page map. */
+static bool
+pml4_is_active (uint64_t *pml4) {
+	return PTE_ADDR (rcr3 ()) == vtop (pml4);
+}
+
+/* Invalidates the TLB entry for VA after a change to PML4.  If PML4
+ * is not active its entries may still be cached under its PCID, so
+ * they are flushed when it is activated next. */
+static void
+pml4_flush_page (uint64_t *pml4, uint64_t va) {
+	if (pml4_is_active (pml4))
+		invlpg (va);
+	else if (pcid_enabled) {
+		enum intr_level old_level = intr_disable ();
+		pml4[PML4_PCID_SLOT] |= PCID_STALE;
+		intr_set_level (old_level);
+	}
+}
+
+/* Returns the CR3 value that activates PML4, assigning it a PCID
+ * first if it has none in the current generation. */
+static uint64_t
+pcid_cr3 (uint64_t *pml4) {
+	uint64_t tag = pml4[PML4_PCID_SLOT];
+	uint64_t cr3 = vtop (pml4);
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if ((tag >> PCID_GEN_SHIFT) != pcid_gen) {
+		if (pcid_next > PCID_MASK) {
+			/* Out of PCIDs.  Changing CR4.PGE flushes every PCID. */
+			uint64_t cr4 = rcr4 ();
+			lcr4 (cr4 ^ CR4_PGE);
+			lcr4 (cr4);
+			pcid_gen++;
+			pcid_next = 1;
+		}
+		/* A fresh PCID has no TLB entries yet. */
+		tag = pcid_gen << PCID_GEN_SHIFT | pcid_next++ << PCID_SHIFT;
+	} else if (tag & PCID_STALE) {
+		tag &= ~(uint64_t) PCID_STALE;
+		pml4[PML4_PCID_SLOT] = tag;
+		return cr3 | ((tag >> PCID_SHIFT) & PCID_MASK);
+	}
+	pml4[PML4_PCID_SLOT] = tag;
+	return cr3 | ((tag >> PCID_SHIFT) & PCID_MASK) | CR3_NOFLUSH;
+}
+
 /* Loads page directory PD into the CPU's page directory base
  * register. */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));
+	if (!pcid_enabled) {
+		lcr3 (vtop (pml4 ? pml4 : base_pml4));
+		return;
+	}
+
+	/* base_pml4 keeps PCID 0.  Its kernel mappings never change. */
+	enum intr_level old_level = intr_disable ();
+	lcr3 (pml4 ? pcid_cr3 (pml4) : vtop (base_pml4) | CR3_NOFLUSH);
+	intr_set_level (old_level);
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -217,7 +390,8 @@ pml4_get_page (uint64_t *pml4, const void *uaddr) {
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) uaddr, 0);
 
 	if (pte && (*pte & PTE_P))
-		return ptov (PTE_ADDR (*pte)) + pg_ofs (uaddr);
+		return ptov (PTE_ADDR (*pte))
+			+ (*pte & PTE_PS ? hpg_ofs (uaddr) : pg_ofs (uaddr));
 	return NULL;
 }
 
@@ -243,25 +417,153 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 	return pte != NULL;
 }
 
+/* Adds a 2 MB mapping in PML4 from the large user virtual page
+ * UPAGE to the physically contiguous frames starting at KPAGE, as
+ * obtained with palloc_get_aligned().  Both must be 2 MB aligned.
+ * No 4 kB page in UPAGE may be mapped; an empty page table left
+ * behind by earlier mappings there is freed.
+ * Returns true if successful, false if memory allocation failed
+ * or part of UPAGE is still mapped.
+ * The mapping is split back into 4 kB pages as soon as a single
+ * page in it is cleared or has its permissions changed. */
+bool
+pml4_set_huge_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
+	ASSERT (hpg_ofs (upage) == 0);
+	ASSERT (hpg_ofs (vtop (kpage)) == 0);
+	ASSERT (is_user_vaddr (upage));
+	ASSERT (pml4 != base_pml4);
+
+	uint64_t *pde = pde_walk (pml4, (uint64_t) upage, 1);
+	if (pde == NULL)
+		return false;
+
+	if (*pde & PTE_P) {
+		uint64_t *pt = ptov (PTE_ADDR (*pde));
+		if (*pde & PTE_PS)
+			return false;
+		for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
+			if (pt[i] & PTE_P)
+				return false;
+		palloc_free_page (pt);
+	}
+
+	*pde = vtop (kpage) | PTE_PS | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+	pml4_flush_page (pml4, (uint64_t) upage);
+	return true;
+}
+
 /* Marks user virtual page UPAGE "not present" in page
  * directory PD.  Later accesses to the page will fault.  Other
  * bits in the page table entry are preserved.
- * UPAGE need not be mapped. */
+ * UPAGE need not be mapped.  If a 2 MB mapping covering UPAGE
+ * cannot be split, the whole mapping is marked not present; the
+ * other pages in it are mapped again one by one when they fault. */
 void
 pml4_clear_page (uint64_t *pml4, void *upage) {
 	uint64_t *pte;
 	ASSERT (pg_ofs (upage) == 0);
 	ASSERT (is_user_vaddr (upage));
 
-	pte = pml4e_walk (pml4, (uint64_t) upage, false);
+	pte = pml4e_walk_small (pml4, (uint64_t) upage);
+	if (pte == NULL)
+		pte = pml4e_walk (pml4, (uint64_t) upage, false);
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
 		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
+		pml4_flush_page (pml4, (uint64_t) upage);
 	}
 }
 
+/* Up to this many pages cleared by pml4_clear_range() are flushed
+ * from the TLB one by one with invlpg; beyond it, reloading CR3 and
+ * refilling the TLB is cheaper. */
+#define CLEAR_RANGE_INVLPG_MAX 32
+
+/* Returns the first address past VA that is aligned to 1 << SHIFT. */
+static uint64_t
+next_boundary (uint64_t va, unsigned shift) {
+	return (va | ((1ULL << shift) - 1)) + 1;
+}
+
+/* Marks every user page in [START, END) of PML4 "not present", as
+ * pml4_clear_page() would, but walks each page table once, skips
+ * missing tables whole, and invalidates the TLB in a single pass at
+ * the end.  2 MB mappings that lie entirely in the range are
+ * cleared without being split.  Returns the number of entries
+ * cleared. */
+size_t
+pml4_clear_range (uint64_t *pml4, void *start, void *end) {
+	uint64_t cleared[CLEAR_RANGE_INVLPG_MAX];
+	uint64_t va = (uint64_t) start;
+	size_t cnt = 0;
+
+	ASSERT (pg_ofs (start) == 0);
+	ASSERT (pg_ofs (end) == 0);
+	ASSERT ((uint64_t) end <= KERN_BASE);
+
+	while (va < (uint64_t) end) {
+		uint64_t *pml4e = &pml4[PML4 (va)];
+		if (!(*pml4e & PTE_P)) {
+			va = next_boundary (va, PML4SHIFT);
+			continue;
+		}
+		uint64_t *pdpe = &((uint64_t *) ptov (PTE_ADDR (*pml4e)))[PDPE (va)];
+		if (!(*pdpe & PTE_P)) {
+			va = next_boundary (va, PDPESHIFT);
+			continue;
+		}
+		uint64_t *pde = &((uint64_t *) ptov (PTE_ADDR (*pdpe)))[PDX (va)];
+		uint64_t next = next_boundary (va, PDXSHIFT);
+		if (!(*pde & PTE_P)) {
+			va = next;
+			continue;
+		}
+
+		if (*pde & PTE_PS) {
+			if (hpg_ofs (va) == 0 && next <= (uint64_t) end) {
+				*pde &= ~PTE_P;
+				if (cnt < CLEAR_RANGE_INVLPG_MAX)
+					cleared[cnt] = va;
+				cnt++;
+				va = next;
+				continue;
+			}
+			if (!pde_split (pde)) {
+				/* As in pml4_clear_page(), drop the whole mapping. */
+				*pde &= ~PTE_P;
+				if (cnt < CLEAR_RANGE_INVLPG_MAX)
+					cleared[cnt] = va;
+				cnt++;
+				va = next;
+				continue;
+			}
+		}
+
+		uint64_t *pt = ptov (PTE_ADDR (*pde));
+		for (; va < next && va < (uint64_t) end; va += PGSIZE) {
+			uint64_t *pte = &pt[PTX (va)];
+			if (*pte & PTE_P) {
+				*pte &= ~PTE_P;
+				if (cnt < CLEAR_RANGE_INVLPG_MAX)
+					cleared[cnt] = va;
+				cnt++;
+			}
+		}
+	}
+
+	if (cnt == 0)
+		return 0;
+	if (!pml4_is_active (pml4))
+		pml4_flush_page (pml4, (uint64_t) start);
+	else if (cnt <= CLEAR_RANGE_INVLPG_MAX)
+		for (size_t i = 0; i < cnt; i++)
+			invlpg (cleared[i]);
+	else
+		/* Without CR3_NOFLUSH this drops the current PCID's entries. */
+		lcr3 (rcr3 ());
+	return cnt;
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PML4 is dirty,
  * that is, if the page has been modified since the PTE was
  * installed.
@@ -273,18 +575,39 @@ pml4_is_dirty (uint64_t *pml4, const void *vpage) {
 }
 
 /* Set the dirty bit to DIRTY in the PTE for virtual page VPAGE
- * in PML4. */
+ * in PML4.  If a 2 MB mapping covering VPAGE cannot be split, the
+ * bit of the whole mapping is set, but never cleared. */
 void
 pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
-	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
+	uint64_t *pte = pml4e_walk_small (pml4, (uint64_t) vpage);
+	if (pte == NULL && dirty)
+		pte = pml4e_walk (pml4, (uint64_t) vpage, false);
 	if (pte) {
 		if (dirty)
 			*pte |= PTE_D;
 		else
 			*pte &= ~(uint32_t) PTE_D;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		pml4_flush_page (pml4, (uint64_t) vpage);
+	}
+}
+
+/* Set the writable bit to WRITABLE in the PTE for virtual page
+ * VPAGE in PML4.  Unlike pml4_set_page(), the accessed and dirty
+ * bits are preserved.  If a 2 MB mapping covering VPAGE cannot be
+ * split, the whole mapping is made read-only, but never writable. */
+void
+pml4_set_writable (uint64_t *pml4, const void *vpage, bool writable) {
+	uint64_t *pte = pml4e_walk_small (pml4, (uint64_t) vpage);
+	if (pte == NULL && !writable)
+		pte = pml4e_walk (pml4, (uint64_t) vpage, false);
+	if (pte) {
+		if (writable)
+			*pte |= PTE_W;
+		else
+			*pte &= ~(uint64_t) PTE_W;
+
+		pml4_flush_page (pml4, (uint64_t) vpage);
 	}
 }
 
@@ -299,17 +622,26 @@ pml4_is_accessed (uint64_t *pml4, const void *vpage) {
 }
 
 /* Sets the accessed bit to ACCESSED in the PTE for virtual page
-   VPAGE in PD. */
+   VPAGE in PD.  Clearing the bit of a page in a 2 MB mapping first
+   splits the mapping, so that the other pages keep theirs; if that
+   fails, the bit of the whole mapping is cleared. */
 void
 pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
-	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
+	uint64_t *pte = NULL;
+	if (!accessed)
+		pte = pml4e_walk_small (pml4, (uint64_t) vpage);
+	if (pte == NULL)
+		pte = pml4e_walk (pml4, (uint64_t) vpage, false);
 	if (pte) {
 		if (accessed)
 			*pte |= PTE_A;
 		else
 			*pte &= ~(uint32_t) PTE_A;
 
-		if (rcr3 () == vtop (pml4))
+		/* A stale entry in another address space only delays the
+		 * next setting of the accessed bit, so it is not worth a
+		 * flush of that address space. */
+		if (pml4_is_active (pml4))
 			invlpg ((uint64_t) vpage);
 	}
 }
@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -31,6 +32,7 @@ struct pool {
 	struct lock lock;               /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
 	uint8_t *base;                  /* Base of pool. */
+	size_t free_cnt;                /* Number of free pages. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -42,6 +44,7 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static void pool_adjust_free_cnt (struct pool *, ptrdiff_t delta);
 
 /* multiboot info */
 struct multiboot_info {
@@ -250,6 +253,10 @@ palloc_init (void) {
 	printf ("\text_mem: 0x%llx ~ 0x%llx (Usable: %'llu kB)\n",
 		  ext_mem.start, ext_mem.end, ext_mem.size / 1024);
 	populate_pools (&base_mem, &ext_mem);
+	kernel_pool.free_cnt = bitmap_count (kernel_pool.used_map, 0,
+			bitmap_size (kernel_pool.used_map), false);
+	user_pool.free_cnt = bitmap_count (user_pool.used_map, 0,
+			bitmap_size (user_pool.used_map), false);
 	return ext_mem.end;
 }
 
@@ -265,6 +272,8 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 
 	lock_acquire (&pool->lock);
 	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+	if (page_idx != BITMAP_ERROR)
+		pool_adjust_free_cnt (pool, -(ptrdiff_t) page_cnt);
 	lock_release (&pool->lock);
 	void *pages;
 
@@ -284,6 +293,42 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	return pages;
 }
 
+/* Like palloc_get_multiple(), but the returned run of PAGE_CNT
+   pages starts at a physical page number that is a multiple of
+   ALIGN pages, so that it can back a large-page mapping. */
+void *
+palloc_get_aligned (enum palloc_flags flags, size_t page_cnt, size_t align) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	size_t pool_cnt = bitmap_size (pool->used_map);
+	size_t page_idx = BITMAP_ERROR;
+
+	ASSERT (align > 0);
+
+	/* Kernel virtual addresses map physical memory at a large-page
+	   aligned offset, so aligning the page number aligns both. */
+	lock_acquire (&pool->lock);
+	for (size_t idx = (align - pg_no (pool->base) % align) % align;
+			idx + page_cnt <= pool_cnt; idx += align)
+		if (bitmap_none (pool->used_map, idx, page_cnt)) {
+			bitmap_set_multiple (pool->used_map, idx, page_cnt, true);
+			pool_adjust_free_cnt (pool, -(ptrdiff_t) page_cnt);
+			page_idx = idx;
+			break;
+		}
+	lock_release (&pool->lock);
+
+	if (page_idx == BITMAP_ERROR) {
+		if (flags & PAL_ASSERT)
+			PANIC ("palloc_get: out of pages");
+		return NULL;
+	}
+
+	void *pages = pool->base + PGSIZE * page_idx;
+	if (flags & PAL_ZERO)
+		memset (pages, 0, PGSIZE * page_cnt);
+	return pages;
+}
+
 /* Obtains a single free page and returns its kernel virtual
    address.
    If PAL_USER is set, the page is obtained from the user pool,
@@ -320,6 +365,33 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #endif
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
 	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	pool_adjust_free_cnt (pool, page_cnt);
+}
+
+/* Frees the CNT pages in PAGES, which need not be adjacent or in
+   order.  PAGES is sorted in place, and each run of adjacent pages
+   is released with a single palloc_free_multiple() call. */
+void
+palloc_free_pages (void **pages, size_t cnt) {
+	/* Batches are small, so insertion sort is enough. */
+	for (size_t i = 1; i < cnt; i++) {
+		uint8_t *page = pages[i];
+		size_t j;
+
+		for (j = i; j > 0 && (uint8_t *) pages[j - 1] > page; j--)
+			pages[j] = pages[j - 1];
+		pages[j] = page;
+	}
+
+	for (size_t i = 0; i < cnt; ) {
+		size_t run = 1;
+
+		while (i + run < cnt
+				&& pages[i + run] == (uint8_t *) pages[i] + run * PGSIZE)
+			run++;
+		palloc_free_multiple (pages[i], run);
+		i += run;
+	}
 }
 
 /* Frees the page at PAGE. */
@@ -328,6 +400,27 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Returns the kernel virtual address of the first page in the
+   user pool.  Pages from the user pool are numbered from here,
+   see palloc_user_page_cnt(). */
+void *
+palloc_user_base (void) {
+	return user_pool.base;
+}
+
+/* Returns the number of pages currently free in the user pool. */
+size_t
+palloc_user_free_cnt (void) {
+	return user_pool.free_cnt;
+}
+
+/* Returns the number of pages the user pool spans, including
+   the holes that were never handed out. */
+size_t
+palloc_user_page_cnt (void) {
+	return bitmap_size (user_pool.used_map);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
@@ -347,6 +440,17 @@ init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
 	*bm_base += bm_pages;
 }
 
+/* Adds DELTA to POOL's free page count.  Freeing does not take
+   the pool lock, because pages are freed from the scheduler when
+   a dying thread's stack is released, so we disable interrupts
+   instead. */
+static void
+pool_adjust_free_cnt (struct pool *pool, ptrdiff_t delta) {
+	enum intr_level old_level = intr_disable ();
+	pool->free_cnt += delta;
+	intr_set_level (old_level);
+}
+
 /* Returns true if PAGE was allocated from POOL,
    false otherwise. */
 static bool
@@ -10,6 +10,7 @@
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
@@ -44,12 +45,26 @@
 
 /* List of processes in THREAD_READY state, that is, processes
    that are ready to run but not actually running. */
-static struct list ready_list;
+//==================================================================
+//				Project 1 - O(1) Run Queue
+//------------------------------------------------------------------
+/*	우선순위마다 FIFO 리스트를 하나씩 두고, 비어 있지 않은 리스트를
+	ready_mask의 비트로 표시한다. 가장 높은 우선순위는 bsr 한 번으로 찾는다.
+	인터럽트를 끈 상태에서만 접근한다. */
+static struct list ready_list[PRI_MAX - PRI_MIN + 1];
+static uint64_t ready_mask;
+static size_t ready_cnt;
+
+static void ReadyPush (struct thread *t);
+static struct thread *ReadyPop (void);
+static int ReadyMaxPriority (void);
+static void ReadyRequeue (struct thread *t, int old_priority);
+//==================================================================
 
 //==================================================================
 //				Project 1 - Alarm Clock
 //------------------------------------------------------------------
-static struct list sleep_list; // ��� �����尡 ����Ǵ� ����Ʈ �ῡ�� �� �����尡 ready_list�� ���� �ȴ�. 
+static void ThreadWakeUp(void *aux);
 //==================================================================
 
 //==================================================================
@@ -57,6 +72,15 @@ static struct list sleep_list; // ��� �����尡 ����Ǵ�
 //------------------------------------------------------------------
 static struct list all_list;
 int load_avg;
+
+// recent_cpu를 줄일 때 쓴 load_avg를 최근 몇 초까지 기억할지
+#define MLFQS_HISTORY 64
+
+static int64_t mlfqs_epoch;					// 부팅 뒤 지난 초, recent_cpu를 줄인 횟수
+static int decay_load[MLFQS_HISTORY];		// 각 초에 recent_cpu를 줄일 때 쓴 load_avg
+static bool ready_decayed;					// ready 스레드의 recent_cpu를 줄인 뒤 우선순위를 아직 다시 계산하지 않았으면 true
+
+static void MlfqsCatchUp (struct thread *t);
 //==================================================================
 
 /* Idle thread. */
@@ -138,14 +162,11 @@ thread_init (void) {
 
 	/* Init the globla thread context */
 	lock_init (&tid_lock);
-	list_init (&ready_list);
+	for (int i = PRI_MIN; i <= PRI_MAX; i++)
+		list_init (&ready_list[i]);
+	ready_mask = 0;
+	ready_cnt = 0;
 	
-	//==================================================================
-	//				Project 1 - Alarm Clock
-	//------------------------------------------------------------------
-	list_init (&sleep_list); // sleep_list �ʱ�ȭ 
-	//==================================================================
-
 	//==================================================================
 	//				Project 1 - mlfqs
 	//------------------------------------------------------------------
@@ -333,7 +354,13 @@ thread_unblock (struct thread *t) {
 	//				Project 1 - Priority Scheduling
 	//------------------------------------------------------------------
 	// �켱���� �������� �����带 �����ϱ� ���ؼ� ���ĵ� ���·� ready_list�� �־��ش�. 
-	list_insert_ordered(&ready_list, &t->elem, CompareThreadByPriority, NULL);
+	if (thread_mlfqs)
+	{
+		// 잠들어 있던 동안 건너뛴 recent_cpu 감소를 반영하고 우선순위를 다시 계산한다.
+		MlfqsCatchUp(t);
+		mlfqsCalculatePriority(t);
+	}
+	ReadyPush(t);
 	//list_push_back (&ready_list, &t->elem);
 	//==================================================================
 
@@ -406,7 +433,12 @@ thread_yield (void) {
 	/*	������ �ڵ�� �׳� push back�� ����ؼ� FIFO ������� ���ǰ� �־���.
 		�켱���� ������� �����ϱ����ؼ� ���� �Լ��� �����ϰ� ���� ������ �̿��Ѵ�. */
 	if (curr != idle_thread)
-		list_insert_ordered(&ready_list, &curr->elem, CompareThreadByPriority, NULL);
+	{
+		// 4 tick 경계 전에 CPU를 내놓아도 늘어난 recent_cpu를 우선순위에 반영한다.
+		if (thread_mlfqs)
+			mlfqsCalculatePriority(curr);
+		ReadyPush(curr);
+	}
 		//list_push_back (&ready_list, &curr->elem);
 
 	//==================================================================
@@ -517,6 +549,12 @@ idle (void *idle_started_ UNUSED) {
 		intr_disable ();
 		thread_block ();
 
+		//==================================================================
+		//				Project 1 - Tickless Idle
+		//------------------------------------------------------------------
+		timer_idle (); // 다음 timer가 만료될 때까지 주기 인터럽트를 멈춘다.
+		//==================================================================
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -568,11 +606,18 @@ init_thread (struct thread *t, const char *name, int priority) {
 	list_init(&t->donations);
 	//==================================================================
 
+	//==================================================================
+	//				Project 1 - Alarm Clock
+	//------------------------------------------------------------------
+	ktimer_setup(&t->sleep_timer, ThreadWakeUp, t);
+	//==================================================================
+
 	//==================================================================
 	//				Project 1 - mlfqs
 	//------------------------------------------------------------------
 	t->nice = NICE_DEFAULT;
 	t->recent_cpu = RECENT_CPU_DEFAULT;
+	t->mlfqs_epoch = mlfqs_epoch;
 	//==================================================================
 
 	/* === project2 - System Call === */
@@ -591,10 +636,10 @@ init_thread (struct thread *t, const char *name, int priority) {
    idle_thread. */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
+	if (ready_mask == 0)
 		return idle_thread;
 	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+		return ReadyPop ();
 }
 
 /* Use iretq to launch the thread */
@@ -774,47 +819,24 @@ void ThreadSleep(int64_t ticks)
 
 	enum intr_level old_level = intr_disable(); // ���ͷ�Ʈ�� ��Ȱ��ȭ ��Ű�鼭 �����صд�. 
 
-	cur->wakeup_ticks = ticks; // ��� �ð� ����
-	list_insert_ordered(&sleep_list, &cur->elem, CompareThreadByTicks, NULL); // ticks�� �������� �����ϸ鼭 sleep_list�� ����
+	ktimer_arm(&cur->sleep_timer, ticks); // ticks 시각에 ThreadWakeUp이 불려 깨어난다.
 	thread_block(); // ���� ������ ����
 
 	intr_set_level(old_level); // ��Ȱ��ȭ ��Ų ���ͷ�Ʈ�� ���� ���·� ����
 }
 
-// l�� ticks�� r�� ticks���� ������ true
-bool CompareThreadByTicks(const struct list_elem* l, const struct list_elem* r, void *aux UNUSED)
-{
-	return list_entry(l, struct thread, elem)->wakeup_ticks < list_entry(r, struct thread, elem)->wakeup_ticks;
-}
-
-void ThreadWakeUp(int64_t current_ticks)
+// sleep_timer가 만료되면 timer 인터럽트 안에서 불린다.
+static void ThreadWakeUp(void *aux)
 {
-	enum intr_level old_level = intr_disable(); // ���ͷ�Ʈ�� ��Ȱ��ȭ ��Ű�鼭 ����
-
-	struct list_elem* iter_sleep_list = list_begin(&sleep_list); // sleep_list�� ��ȸ�� ����
+	struct thread* t = aux;
 
-	while(iter_sleep_list != list_end(&sleep_list))
-	{
-		struct thread* cur_thread = list_entry(iter_sleep_list, struct thread, elem); // ���� �˻����� elem�� ������
+	thread_unblock(t); // ready_list로 이동
 
-		if(current_ticks >= cur_thread->wakeup_ticks) // ��� �ð��̶�� 
-		{
-			iter_sleep_list = list_remove(iter_sleep_list); // sleep_list���� ���� 
-			thread_unblock(cur_thread); // ready_list�� �̵�
-
-			//==================================================================
-			//				Project 1 - Priority Scheduling
-			//------------------------------------------------------------------
-			ThreadYieldByPriority();
-			//==================================================================			
-		}
-		else // �� �ð��� �ƴ϶�� 
-		{
-			//iter_sleep_list = list_next(iter_sleep_list); // ���� elem���� 
-			break; // ���ĵǾ������Ƿ� �˻� �ʿ� ���� 
-		}
-	}
-	intr_set_level(old_level); // ��Ȱ��ȭ ��Ų ���ͷ�Ʈ�� ������� �ǵ��� 
+	//==================================================================
+	//				Project 1 - Priority Scheduling
+	//------------------------------------------------------------------
+	ThreadYieldByPriority();
+	//==================================================================
 }
 //==================================================================
 
@@ -835,14 +857,14 @@ void ThreadYieldByPriority()
 	 if(idle_thread == thread_current())
 		return;
 	
-	 if(list_empty(&ready_list))
+	 if(ready_mask == 0)
 	 	return;
 	
-	struct thread* ready = list_entry(list_front(&ready_list), struct thread, elem);
+	int ready_priority = ReadyMaxPriority();
 	// if(thread_get_priority() < ready->priority) // ready_list�� ���� �������� �����庸�� �켱������ ���� �����尡 ������
 	// 	thread_yield();
 
-	if(thread_get_priority() < ready->priority) // ready_list�� ���� �������� �����庸�� �켱������ ���� �����尡 ������
+	if(thread_get_priority() < ready_priority) // ready_list�� ���� �������� �����庸�� �켱������ ���� �����尡 ������
 	{ 
 		if (intr_context())
 			intr_yield_on_return();
@@ -865,7 +887,13 @@ void DonatePriority()
 	while(NULL != cur_thread->wait_on_lock)
 	{
 		struct thread* holder = cur_thread->wait_on_lock->holder;
+		enum intr_level old_level = intr_disable();
+		int old_priority = holder->priority;
 		holder->priority = cur_thread->priority;
+		// ready 상태인 holder는 새 우선순위의 리스트로 옮긴다.
+		if(holder->status == THREAD_READY)
+			ReadyRequeue(holder, old_priority);
+		intr_set_level(old_level);
 		cur_thread = holder;
 	}
 
@@ -924,6 +952,53 @@ void mlfqsCalculatePriority (struct thread *th)
 		return;
 	
 	th->priority = fp_to_int(add_mixed(div_mixed(th->recent_cpu, -4), PRI_MAX - th->nice * 2));
+	// 우선순위로 ready_list를 고르므로 범위를 벗어나지 않게 한다.
+	if (th->priority < PRI_MIN)
+		th->priority = PRI_MIN;
+	else if (th->priority > PRI_MAX)
+		th->priority = PRI_MAX;
+}
+
+// LOAD를 쓰는 1초 동안의 recent_cpu 감소
+static int DecayRecentCPU (int recent_cpu, int nice, int load)
+{
+	return add_mixed (mult_fp (div_fp (mult_mixed (load, 2), add_mixed (mult_mixed (load, 2), 1)), recent_cpu), nice);
+}
+
+// 같은 LOAD로 COUNT초 동안 줄인 recent_cpu.
+// d = 2L/(2L+1)이면 x = d^n * x + nice * (2L+1) * (1 - d^n) 이다.
+static int DecayRecentCPUMany (int recent_cpu, int nice, int load, int64_t count)
+{
+	int d = div_fp (mult_mixed (load, 2), add_mixed (mult_mixed (load, 2), 1));
+	int power = int_to_fp (1);
+
+	for (; count > 0; count >>= 1, d = mult_fp (d, d))
+		if (count & 1)
+			power = mult_fp (power, d);
+
+	return add_fp (mult_fp (power, recent_cpu),
+			mult_fp (mult_mixed (add_mixed (mult_mixed (load, 2), 1), nice), sub_fp (int_to_fp (1), power)));
+}
+
+// T가 건너뛴 초만큼 recent_cpu를 줄인다. 잠든 스레드는 깨어날 때 한꺼번에 줄인다.
+// 기록이 남아 있지 않은 오래된 초는 남아 있는 것 중 가장 오래된 load_avg로 계산한다.
+static void MlfqsCatchUp (struct thread *t)
+{
+	int64_t epoch = t->mlfqs_epoch;
+
+	if (t == idle_thread || epoch == mlfqs_epoch)
+		return;
+
+	if (mlfqs_epoch - epoch > MLFQS_HISTORY)
+	{
+		int64_t skip = mlfqs_epoch - MLFQS_HISTORY - epoch;
+
+		epoch = mlfqs_epoch - MLFQS_HISTORY;
+		t->recent_cpu = DecayRecentCPUMany (t->recent_cpu, t->nice, decay_load[epoch % MLFQS_HISTORY], skip);
+	}
+	for (; epoch < mlfqs_epoch; epoch++)
+		t->recent_cpu = DecayRecentCPU (t->recent_cpu, t->nice, decay_load[epoch % MLFQS_HISTORY]);
+	t->mlfqs_epoch = mlfqs_epoch;
 }
 
 void mlfqsCalculateRecentCPU (struct thread *th)
@@ -931,7 +1006,7 @@ void mlfqsCalculateRecentCPU (struct thread *th)
 	if (th == idle_thread)
 		return;
 
-	 th->recent_cpu = add_mixed (mult_fp (div_fp (mult_mixed (load_avg, 2), add_mixed (mult_mixed (load_avg, 2), 1)), th->recent_cpu), th->nice);
+	th->recent_cpu = DecayRecentCPU (th->recent_cpu, th->nice, load_avg);
 }
 
 void mlfqsCalculateLoadAvg (void)
@@ -939,9 +1014,9 @@ void mlfqsCalculateLoadAvg (void)
 	int ready_threads;
 
 	if(thread_current() == idle_thread)
-		ready_threads = list_size(&ready_list);
+		ready_threads = ready_cnt;
 	else
-		ready_threads = list_size(&ready_list) + 1;
+		ready_threads = ready_cnt + 1;
 	 
 	load_avg = add_fp (mult_fp (div_fp (int_to_fp (59), int_to_fp (60)), load_avg), 
                      mult_mixed (div_fp (int_to_fp (1), int_to_fp (60)), ready_threads));
@@ -953,42 +1028,103 @@ void mlfqsIncrementRecentCPU (void)
 		thread_current()->recent_cpu = add_mixed (thread_current()->recent_cpu, 1);
 }
 
-// ��� �������� recent_cpu�� ����
+// 1초가 지났다. 실행 중이거나 ready 상태인 스레드만 recent_cpu를 줄이고
+// block 된 스레드는 깨어날 때 MlfqsCatchUp으로 줄인다.
 void mlfqsRecalculateRecentCPU (void)
 {
-	for(struct list_elem* iter = list_begin(&all_list); iter != list_end(&all_list); iter = list_next(iter))
+	decay_load[mlfqs_epoch % MLFQS_HISTORY] = load_avg;
+	mlfqs_epoch++;
+
+	MlfqsCatchUp(thread_current());
+	for (int priority = PRI_MIN; priority <= PRI_MAX; priority++)
 	{
-		mlfqsCalculateRecentCPU(list_entry(iter, struct thread, allelem));
+		struct list *list = &ready_list[priority];
+
+		for (struct list_elem *e = list_begin(list); e != list_end(list); e = list_next(e))
+			MlfqsCatchUp(list_entry(e, struct thread, elem));
 	}
+	ready_decayed = true;
 }
 
+// 4 tick 사이에 recent_cpu가 바뀌는 것은 실행 중인 스레드뿐이다.
+// 그 사이에 CPU를 내놓은 스레드는 thread_yield나 thread_unblock에서 다시 계산한다.
+// ready 스레드는 1초마다 recent_cpu가 줄어든 뒤에 한 번만 다시 계산한다.
 void mlfqsRecalculatePrioirty (void)
 {
-	// for(struct list_elem* iter = list_begin(&all_list); iter != list_end(&all_list); iter = list_next(iter))
-	// {
-	// 	mlfqsCalculatePriority(list_entry(iter, struct thread, allelem));
-	// }
+	mlfqsCalculatePriority(thread_current());
 
-	struct list_elem *e;
-    int old_priority = thread_current()->priority;
-
-    for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e))
-    {
-        struct thread *t = list_entry(e, struct thread, allelem);
-        int t_old_priority = t->priority;
-        mlfqsCalculatePriority(t);
-
-        if (t != idle_thread && t->status == THREAD_READY)
-        {
-            if (t->priority != t_old_priority)
-            {
-                list_remove(&t->elem);
-                list_insert_ordered(&ready_list, &t->elem, CompareThreadByPriority, NULL);
-            }
-        }
-    }
+	if (ready_decayed)
+	{
+		for (int priority = PRI_MAX; priority >= PRI_MIN; priority--)
+		{
+			struct list *list = &ready_list[priority];
+			struct list_elem *e = list_begin(list);
+
+			while (e != list_end(list))
+			{
+				struct thread *t = list_entry(e, struct thread, elem);
+
+				e = list_next(e);
+				mlfqsCalculatePriority(t);
+				if (t->priority != priority)
+					ReadyRequeue(t, priority);
+			}
+		}
+		ready_decayed = false;
+	}
 
 	ThreadYieldByPriority();
 }
 
-//==================================================================
\ No newline at end of file
+//==================================================================
+
+
+//==================================================================
+//				Project 1 - O(1) Run Queue
+//------------------------------------------------------------------
+// T를 자기 우선순위 리스트의 맨 뒤에 넣는다.
+static void ReadyPush (struct thread *t)
+{
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->priority >= PRI_MIN && t->priority <= PRI_MAX);
+
+	list_push_back(&ready_list[t->priority], &t->elem);
+	ready_mask |= 1ULL << t->priority;
+	ready_cnt++;
+}
+
+// ready 상태 스레드 중 가장 높은 우선순위
+static int ReadyMaxPriority (void)
+{
+	ASSERT (ready_mask != 0);
+
+	return 63 - __builtin_clzll(ready_mask);
+}
+
+// 가장 높은 우선순위 리스트의 맨 앞 스레드를 꺼낸다.
+static struct thread *ReadyPop (void)
+{
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	int priority = ReadyMaxPriority();
+	struct thread *t = list_entry(list_pop_front(&ready_list[priority]), struct thread, elem);
+
+	if (list_empty(&ready_list[priority]))
+		ready_mask &= ~(1ULL << priority);
+	ready_cnt--;
+	return t;
+}
+
+// OLD_PRIORITY 리스트에 있던 T를 바뀐 우선순위의 리스트로 옮긴다.
+static void ReadyRequeue (struct thread *t, int old_priority)
+{
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->status == THREAD_READY);
+
+	list_remove(&t->elem);
+	if (list_empty(&ready_list[old_priority]))
+		ready_mask &= ~(1ULL << old_priority);
+	ready_cnt--;
+	ReadyPush(t);
+}
+//==================================================================
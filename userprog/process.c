@@ -18,6 +18,7 @@
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
+#include "threads/malloc.h"
 #include "intrinsic.h"
 #ifdef VM
 #include "vm/vm.h"
@@ -28,9 +29,6 @@ static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
 static void __do_fork (void *);
 
-/* Project 2 - System Call */
-struct lock filesys_lock;  // 파일 읽기/쓰기 용 lock
-
 /* General process initializer for initd and other process. */
 static void
 process_init (void) {
@@ -170,6 +168,11 @@ __do_fork (void *aux) {
 
 	process_activate (current);
 #ifdef VM
+	/* 아직 읽지 않은 실행 파일 페이지가 부모의 run_file에 묶이지 않도록
+	 * 자식도 실행 파일을 따로 열어 둔다. */
+	current->run_file = file_duplicate (parent->run_file);
+	if (parent->run_file != NULL && current->run_file == NULL)
+		goto error;
 	supplemental_page_table_init (&current->spt);
 	if (!supplemental_page_table_copy (&current->spt, &parent->spt))
 		goto error;
@@ -499,6 +502,13 @@ load (const char *file_name, struct intr_frame *if_) {
 					if (!load_segment (file, file_page, (void *) mem_page,
 								read_bytes, zero_bytes, writable))
 						goto done;
+#ifdef VM
+					/* === project3 - Anonymous Memory === */
+					/* 힙은 가장 높은 세그먼트 바로 뒤에서 시작한다. */
+					void *seg_end = (void *) (mem_page + read_bytes + zero_bytes);
+					if (seg_end > t->spt.heap_start)
+						t->spt.heap_start = t->spt.brk = seg_end;
+#endif
 				}
 				else
 					goto done;
@@ -670,6 +680,8 @@ install_page (void *upage, void *kpage, bool writable) {
 			&& pml4_set_page (t->pml4, upage, kpage, writable));
 }
 
+#endif /* VM */
+
 /* === project2 - Command Line Parsing === */
 void argument_stack(char **argv, int argc, struct intr_frame *if_)
 {
@@ -771,7 +783,7 @@ process_insert_file(int fd, struct file *f) {
     return fd;
 }
 
-#else
+#ifdef VM
 /* From here, codes will be used after project 3.
  * If you want to implement the function for only project 2, implement it on the
  * upper block. */
@@ -781,6 +793,18 @@ lazy_load_segment (struct page *page, void *aux) {
 	/* TODO: Load the segment from the file */
 	/* TODO: This called when the first page fault occurs on address VA. */
 	/* TODO: VA is available when calling this function. */
+	struct lazy_load_arg *arg = aux;
+	void *kva = page->frame->kva;
+	bool success = true;
+
+	if (file_read_at (arg->file, kva, arg->read_bytes, arg->ofs)
+			!= (off_t) arg->read_bytes)
+		success = false;
+	else
+		memset ((uint8_t *) kva + arg->read_bytes, 0, arg->zero_bytes);
+
+	free (arg);
+	return success;
 }
 
 /* Loads a segment starting at offset OFS in FILE at address
@@ -812,15 +836,25 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
 		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-		void *aux = NULL;
+		struct lazy_load_arg *aux = malloc (sizeof *aux);
+		if (aux == NULL)
+			return false;
+		aux->file = file;
+		aux->ofs = ofs;
+		aux->read_bytes = page_read_bytes;
+		aux->zero_bytes = page_zero_bytes;
+
 		if (!vm_alloc_page_with_initializer (VM_ANON, upage,
-					writable, lazy_load_segment, aux))
+					writable, lazy_load_segment, aux)) {
+			free (aux);
 			return false;
+		}
 
 		/* Advance. */
 		read_bytes -= page_read_bytes;
 		zero_bytes -= page_zero_bytes;
 		upage += PGSIZE;
+		ofs += page_read_bytes;
 	}
 	return true;
 }
@@ -835,6 +869,11 @@ setup_stack (struct intr_frame *if_) {
 	 * TODO: If success, set the rsp accordingly.
 	 * TODO: You should mark the page is stack. */
 	/* TODO: Your code goes here */
+	if (vm_alloc_page (VM_ANON | VM_STACK, stack_bottom, true)
+			&& vm_claim_page (stack_bottom)) {
+		if_->rsp = USER_STACK;
+		success = true;
+	}
 
 	return success;
 }
@@ -2,6 +2,7 @@
 
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
@@ -14,6 +15,10 @@
 /** #Project 2: System Call */
 #include "filesys/filesys.h"
 #include "threads/palloc.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/vm.h"
+#endif
 
 
 void syscall_entry (void);
@@ -56,6 +61,11 @@ syscall_handler (struct intr_frame *f UNUSED) {
 	// TODO: Your implementation goes here.
 	int sys_number = f->R.rax; // rax에 있는 시스템 콜 번호 추출
 
+#ifdef VM
+	/* === project3 - Stack Growth === */
+	thread_current()->user_rsp = (void *) f->rsp;	// 커널에서 난 page fault용 사용자 rsp
+#endif
+
 	switch(sys_number)
 	{
 		case SYS_HALT:
@@ -103,6 +113,27 @@ syscall_handler (struct intr_frame *f UNUSED) {
 		case SYS_DUP2:
             f->R.rax = dup2(f->R.rdi, f->R.rsi);
             break;
+#ifdef VM
+		case SYS_MMAP:
+			f->R.rax = (uint64_t) mmap((void *) f->R.rdi, f->R.rsi, f->R.rdx,
+					f->R.r10, f->R.r8, f->R.r9);
+			break;
+		case SYS_MUNMAP:
+			munmap((void *) f->R.rdi);
+			break;
+		case SYS_VMSTAT:
+			f->R.rax = vmstat(f->R.rdi, (void *) f->R.rsi);
+			break;
+		case SYS_MADVISE:
+			f->R.rax = madvise((void *) f->R.rdi, f->R.rsi, f->R.rdx);
+			break;
+		case SYS_PREFAULT:
+			f->R.rax = prefault((void *) f->R.rdi, f->R.rsi);
+			break;
+		case SYS_SBRK:
+			f->R.rax = (uint64_t) sbrk(f->R.rdi);
+			break;
+#endif
 		default:
 			exit(-1);
 		}
@@ -110,8 +141,21 @@ syscall_handler (struct intr_frame *f UNUSED) {
 
 void check_address(void *addr) {
 	/* 유저 영역이 아닌 경우 프로세스 종료 */
-	if (is_kernel_vaddr(addr) || addr == NULL || pml4_get_page(thread_current() -> pml4, addr) == NULL)
+	if (is_kernel_vaddr(addr) || addr == NULL)
+		exit(-1);
+#ifdef VM
+	/* === project3 - Memory Management === */
+	/* 아직 올라오지 않은(lazy) 페이지도 spt에 있으면 유효한 주소.
+	 * 스택 영역은 커널이 접근할 때 page fault로 자라므로 통과시킨다. */
+	struct thread *curr = thread_current();
+	if (spt_find_page(&curr->spt, addr) == NULL
+			&& !(addr >= curr->user_rsp - 8 && addr < (void *) USER_STACK
+				&& addr >= (void *) (USER_STACK - STACK_LIMIT)))
 		exit(-1);
+#else
+	if (pml4_get_page(thread_current() -> pml4, addr) == NULL)
+		exit(-1);
+#endif
 }
 
 /* 핀토스를 종료시키는 시스템 콜 */
@@ -200,6 +244,13 @@ int filesize(int fd) {
 int read(int fd, void *buffer, unsigned length)
 {
 	check_address(buffer);
+#ifdef VM
+	/* === project3 - Memory Management === */
+	/* 읽기 전용 페이지(코드 영역 등)에 쓰려고 하면 종료 */
+	struct page *page = spt_find_page(&thread_current()->spt, buffer);
+	if (page != NULL && !page->writable)
+		exit(-1);
+#endif
 
 	if (fd == 0){
 		int i =0;
@@ -318,4 +369,126 @@ int dup2(int oldfd, int newfd) {
     newfd = process_insert_file(newfd, oldfile);
 
     return newfd;
-}
\ No newline at end of file
+}
+
+#ifdef VM
+/* === project3 - Memory Mapped Files === */
+/* fd로 열린 파일을 addr부터 length 바이트만큼 메모리에 매핑.
+ * fd가 -1이면 0으로 채워진 익명 메모리를 매핑하고, 이때 addr이
+ * NULL이면 커널이 빈 자리를 고른다.
+ * flags에 MAP_POPULATE가 켜져 있으면 매핑 전체를 미리 읽어 둔다. */
+void *mmap(void *addr, size_t length, int writable, int fd, off_t offset,
+		int flags)
+{
+	struct thread *curr = thread_current();
+	struct file *file = NULL;
+
+	if (flags & ~MAP_POPULATE)
+		return NULL;
+
+	/* === project3 - Anonymous Memory === */
+	if (fd == -1 && addr == NULL && (long long) length > 0)
+		addr = anon_find_area(length);
+
+	/* 주소와 오프셋은 페이지 정렬되어 있어야 하고, 길이가 0이면 안 된다. */
+	if (addr == NULL || pg_ofs(addr) != 0 || pg_ofs(offset) != 0
+			|| offset < 0 || (long long) length <= 0)
+		return NULL;
+	if (is_kernel_vaddr(addr) || is_kernel_vaddr((uint8_t *) addr + length)
+			|| (uint8_t *) addr + length < (uint8_t *) addr)
+		return NULL;
+
+	if (fd != -1) {
+		if (fd < 0 || fd >= FDCOUNT_LIMIT)
+			return NULL;
+		file = process_get_file(fd);
+		if (file == NULL || file <= (struct file *) STDERR
+				|| file_length(file) == 0)
+			return NULL;
+	}
+
+	/* 기존 페이지(코드, 스택, 다른 매핑)와 겹치면 실패 */
+	for (uint8_t *va = addr; va < (uint8_t *) addr + length; va += PGSIZE)
+		if (spt_find_page(&curr->spt, va) != NULL)
+			return NULL;
+
+	if (file == NULL) {
+		if (do_mmap_anon(addr, length, writable) == NULL)
+			return NULL;
+	} else if (do_mmap(addr, length, writable, file, offset) == NULL)
+		return NULL;
+	/* === project3 - Populate === */
+	/* 미리 읽지 못한 페이지는 보통처럼 첫 접근 때 읽으면 되므로
+	 * 실패해도 매핑은 그대로 둔다. */
+	if (flags & MAP_POPULATE)
+		vm_populate(addr, pg_round_up((uint8_t *) addr + length));
+	return addr;
+}
+
+/* mmap으로 매핑된 영역을 해제 */
+void munmap(void *addr)
+{
+	do_munmap(addr);
+}
+
+/* === project3 - VM Statistics === */
+/* 이 프로세스(global이면 시스템 전체)의 VM 통계를 stats에 복사 */
+bool vmstat(bool global, struct vm_stats *stats)
+{
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	uint8_t *end = (uint8_t *) stats + sizeof *stats - 1;
+
+	/* 버퍼의 처음과 끝이 모두 쓸 수 있는 유저 페이지여야 한다. */
+	check_address(stats);
+	check_address(end);
+	struct page *page = spt_find_page(spt, stats);
+	if (page != NULL && !page->writable)
+		exit(-1);
+	page = spt_find_page(spt, end);
+	if (page != NULL && !page->writable)
+		exit(-1);
+
+	memcpy(stats, global ? &vm_stats : &spt->stats, sizeof *stats);
+	return true;
+}
+
+/* === project3 - madvise === */
+/* addr부터 length 바이트 구간의 접근 패턴을 알려 준다.
+ * 성공하면 0, 잘못된 인자면 -1을 반환한다. */
+int madvise(void *addr, size_t length, int advice)
+{
+	uint8_t *end = (uint8_t *) addr + length;
+
+	/* 주소는 페이지 정렬되어 있어야 하고, 구간 전체가 유저 영역이어야 한다. */
+	if (pg_ofs(addr) != 0 || end < (uint8_t *) addr
+			|| is_kernel_vaddr(addr) || (uint64_t) end > KERN_BASE)
+		return -1;
+	if (length == 0)
+		return 0;
+
+	return vm_madvise(addr, length, advice) ? 0 : -1;
+}
+
+/* === project3 - Populate === */
+/* addr부터 length 바이트 구간을 미리 읽어 매핑한다.
+ * 성공하면 0, 잘못된 인자이거나 메모리가 부족하면 -1을 반환한다. */
+int prefault(void *addr, size_t length)
+{
+	uint8_t *start = pg_round_down(addr);
+	uint8_t *end = (uint8_t *) addr + length;
+
+	if (end < (uint8_t *) addr || is_kernel_vaddr(addr)
+			|| (uint64_t) end > KERN_BASE)
+		return -1;
+
+	return vm_populate(start, pg_round_up(end)) ? 0 : -1;
+}
+
+/* === project3 - Anonymous Memory === */
+/* 힙의 끝을 increment 바이트 옮기고 옮기기 전의 끝을 반환한다.
+ * 옮길 수 없으면 (void *) -1을 반환한다. */
+void *sbrk(intptr_t increment)
+{
+	return vm_sbrk(increment);
+}
+#endif
@@ -1,7 +1,15 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
 #include "vm/vm.h"
+#include <bitmap.h>
+#include <round.h>
+#include <string.h>
 #include "devices/disk.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/zswap.h"
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -17,11 +25,48 @@ static const struct page_operations anon_ops = {
 	.type = VM_ANON,
 };
 
+/* === project3 - Swap In/Out === */
+/* 페이지 하나를 담는 swap 슬롯의 섹터 수 */
+#define SECTORS_PER_PAGE (PGSIZE / DISK_SECTOR_SIZE)
+
+/* swap 슬롯 사용 여부. true면 사용 중이다. */
+static struct bitmap *swap_table;
+static struct lock swap_lock;
+
+/* === project3 - Copy On Write === */
+/* 슬롯마다 그 슬롯을 가리키는 페이지 수. 함께 매핑되던 frame을 내보내면
+ * 여러 페이지가 한 슬롯을 가리킨다. 0이 되면 슬롯을 놓는다.
+ * swap_lock이 보호한다. */
+static unsigned *slot_refs;
+
+/* 여러 페이지를 한 번의 디스크 명령으로 쓰기 위해 모아 두는 버퍼.
+ * eviction은 frame_lock을 놓고 쓰므로 따로 락을 둔다. */
+static uint8_t *cluster_buf;
+static struct lock cluster_lock;
+
+/* readahead로 연속된 슬롯을 한 번에 읽어 오는 버퍼 */
+static uint8_t *readahead_buf;
+static struct lock readahead_lock;
+
 /* Initialize the data for anonymous pages */
 void
 vm_anon_init (void) {
 	/* TODO: Set up the swap_disk. */
-	swap_disk = NULL;
+	size_t slot_cnt = 0;
+
+	swap_disk = disk_get (1, 1);
+	if (swap_disk != NULL)
+		slot_cnt = disk_size (swap_disk) / SECTORS_PER_PAGE;
+	swap_table = bitmap_create (slot_cnt);
+	/* swap 디스크가 없어도 NULL이 아니도록 한 칸 더 잡는다. */
+	slot_refs = calloc (slot_cnt + 1, sizeof *slot_refs);
+	if (swap_table == NULL || slot_refs == NULL)
+		PANIC ("vm_anon_init: cannot allocate swap table");
+	lock_init (&swap_lock);
+	cluster_buf = palloc_get_multiple (PAL_ASSERT, SWAP_CLUSTER);
+	lock_init (&cluster_lock);
+	readahead_buf = palloc_get_multiple (PAL_ASSERT, SWAP_READAHEAD_MAX);
+	lock_init (&readahead_lock);
 }
 
 /* Initialize the file mapping */
@@ -31,22 +76,282 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 	page->operations = &anon_ops;
 
 	struct anon_page *anon_page = &page->anon;
+	anon_page->swap_slot = SWAP_SLOT_NONE;
+	anon_page->prefetched = false;
+	anon_page->zswap = NULL;
+
+	/* 익명 페이지는 0으로 채워진 상태로 시작한다.
+	 * KVA가 NULL이면 zero page에 매핑하는 경우라 채울 frame이 없다. */
+	if (kva != NULL)
+		memset (kva, 0, PGSIZE);
+	return true;
 }
 
 /* Swap in the page by read contents from the swap disk. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
+	size_t slot;
+
+	/* 압축 캐시에 있으면 디스크를 읽지 않는다. */
+	if (vm_zswap && zswap_load (page, kva)) {
+		vm_stat_add (thread_current (), swap_ins, 1);
+		return true;
+	}
+
+	slot = anon_page->swap_slot;
+	if (slot == SWAP_SLOT_NONE)
+		return false;
+
+	disk_read_multiple (swap_disk, slot * SECTORS_PER_PAGE,
+			SECTORS_PER_PAGE, kva);
+	vm_stat_add (thread_current (), swap_ins, 1);
+
+	/* 슬롯은 그대로 둔다. 다시 쫓겨날 때까지 내용이 바뀌지 않으면
+	 * 디스크에 쓰지 않고 frame만 버릴 수 있다. */
+	return true;
+}
+
+/* === project3 - Copy On Write === */
+/* swap된 PAGE의 내용을 KVA로 읽어 온다. 슬롯은 그대로 둔다.
+ * fork가 자식 몫의 사본을 만들 때 쓴다. */
+void
+anon_read_slot (struct page *page, void *kva) {
+	size_t slot = page->anon.swap_slot;
+
+	if (page->anon.zswap != NULL) {
+		zswap_copy (page, kva);
+		return;
+	}
+	ASSERT (slot != SWAP_SLOT_NONE);
+	disk_read_multiple (swap_disk, slot * SECTORS_PER_PAGE,
+			SECTORS_PER_PAGE, kva);
+}
+
+/* === project3 - Clustered Swap Out === */
+/* 연속된 슬롯 CNT개를 잡아 첫 슬롯 번호를 반환한다. 잡은 슬롯은 아직
+ * 어느 페이지도 가리키지 않는다.
+ * 그만큼 연속된 빈 자리가 없으면 SWAP_SLOT_NONE을 반환한다. */
+size_t
+anon_reserve_slots (size_t cnt) {
+	lock_acquire (&swap_lock);
+	size_t slot = bitmap_scan_and_flip (swap_table, 0, cnt, false);
+	if (slot != BITMAP_ERROR)
+		for (size_t i = 0; i < cnt; i++)
+			slot_refs[slot + i] = 0;
+	lock_release (&swap_lock);
+	return slot == BITMAP_ERROR ? SWAP_SLOT_NONE : slot;
+}
+
+/* === project3 - Copy On Write === */
+/* SLOT을 가리키던 페이지 하나가 떠난다. 마지막이었으면 슬롯을 놓는다.
+ * swap_lock을 잡은 상태여야 한다. */
+static void
+slot_put (size_t slot) {
+	ASSERT (slot_refs[slot] > 0);
+
+	if (--slot_refs[slot] == 0)
+		bitmap_reset (swap_table, slot);
+}
+
+/* PAGE가 가리키던 슬롯을 놓고 SLOT을 가리키게 한다. */
+void
+anon_attach_slot (struct page *page, size_t slot) {
+	struct anon_page *anon_page = &page->anon;
+
+	lock_acquire (&swap_lock);
+	slot_refs[slot]++;
+	if (anon_page->swap_slot != SWAP_SLOT_NONE)
+		slot_put (anon_page->swap_slot);
+	anon_page->swap_slot = slot;
+	lock_release (&swap_lock);
+}
+
+/* SLOT을 둘 이상의 페이지가 가리키는지 확인한다. */
+bool
+anon_slot_shared (size_t slot) {
+	lock_acquire (&swap_lock);
+	bool shared = slot_refs[slot] > 1;
+	lock_release (&swap_lock);
+	return shared;
+}
+
+/* 여러 페이지가 함께 매핑한 frame의 내용 KVA를 anon_reserve_slots로 잡아
+ * 둔 SLOT에 한 번 쓴다. 페이지마다 anon_attach_slot으로 이 슬롯을
+ * 가리키게 해야 한다. frame_lock은 잡지 않아도 된다. */
+void
+anon_write_shared (size_t slot, const void *kva) {
+	disk_write_multiple (swap_disk, slot * SECTORS_PER_PAGE,
+			SECTORS_PER_PAGE, kva);
+}
+
+/* PAGES[0..CNT)를 anon_reserve_slots로 잡아 둔 SLOT부터 차례로 쓴다.
+ * 호출자가 매핑을 모두 끊고 frame을 pin 해 둔 뒤 불러야 하며,
+ * frame_lock은 잡지 않아도 된다.
+ * 페이지마다 명령을 보내는 대신 연속된 섹터를 한 번에 쓴다. */
+void
+anon_swap_out_cluster (struct page **pages, size_t cnt, size_t slot) {
+	ASSERT (cnt <= SWAP_CLUSTER);
+
+	lock_acquire (&cluster_lock);
+	for (size_t i = 0; i < cnt; i++)
+		memcpy (cluster_buf + i * PGSIZE, pages[i]->frame->kva, PGSIZE);
+	disk_write_multiple (swap_disk, slot * SECTORS_PER_PAGE,
+			cnt * SECTORS_PER_PAGE, cluster_buf);
+	lock_release (&cluster_lock);
+
+	lock_acquire (&swap_lock);
+	for (size_t i = 0; i < cnt; i++) {
+		struct anon_page *anon_page = &pages[i]->anon;
+		if (anon_page->swap_slot != SWAP_SLOT_NONE)
+			slot_put (anon_page->swap_slot);
+		anon_page->swap_slot = slot + i;
+		slot_refs[slot + i] = 1;
+		vm_stat_add (pages[i]->frame->owner, swap_outs, 1);
+	}
+	lock_release (&swap_lock);
+}
+
+/* === project3 - Swap Readahead === */
+/* SLOT부터 연속된 CNT개 슬롯을 한 번의 디스크 명령으로 읽어
+ * KVAS[i]에 차례로 채운다. 슬롯은 그대로 둔다. */
+void
+anon_read_slots (size_t slot, size_t cnt, void **kvas) {
+	ASSERT (cnt <= SWAP_READAHEAD_MAX);
+
+	lock_acquire (&readahead_lock);
+	disk_read_multiple (swap_disk, slot * SECTORS_PER_PAGE,
+			cnt * SECTORS_PER_PAGE, readahead_buf);
+	for (size_t i = 0; i < cnt; i++)
+		memcpy (kvas[i], readahead_buf + i * PGSIZE, PGSIZE);
+	lock_release (&readahead_lock);
+}
+
+/* BUF의 내용을 PAGE의 swap 슬롯에 쓴다. 슬롯이 없거나 다른 페이지와
+ * 함께 가리키는 슬롯이면 새로 잡는다. */
+static bool
+anon_write_slot (struct page *page, const void *buf) {
+	struct anon_page *anon_page = &page->anon;
+
+	if (anon_page->swap_slot == SWAP_SLOT_NONE
+			|| anon_slot_shared (anon_page->swap_slot)) {
+		size_t slot = anon_reserve_slots (1);
+		if (slot == SWAP_SLOT_NONE)
+			return false;
+		anon_attach_slot (page, slot);
+	}
+
+	disk_write_multiple (swap_disk, anon_page->swap_slot * SECTORS_PER_PAGE,
+			SECTORS_PER_PAGE, buf);
+	return true;
+}
+
+/* === project3 - WSClock === */
+/* cleaner가 떠 둔 PAGE의 사본 BUF를 swap에 미리 써 둔다.
+ * 이후 eviction 때 dirty가 아니면 쓰기 없이 frame을 버릴 수 있다. */
+bool
+anon_clean (struct page *page, const void *buf) {
+	/* cleaner 스레드가 쓰므로 프로세스 몫으로는 세지 않는다. */
+	if (!anon_write_slot (page, buf))
+		return false;
+	vm_stats.swap_outs++;
+	return true;
+}
+
+/* === project3 - Compressed Swap Cache === */
+/* 압축 캐시가 가득 차 밀려난 PAGE의 내용 BUF를 swap에 쓴다. */
+bool
+anon_spill (struct page *page, const void *buf) {
+	return anon_write_slot (page, buf);
+}
+
+/* PAGE의 swap 슬롯을 놓는다. */
+static void
+anon_release_slot (struct page *page) {
+	struct anon_page *anon_page = &page->anon;
+
+	if (anon_page->swap_slot != SWAP_SLOT_NONE) {
+		lock_acquire (&swap_lock);
+		slot_put (anon_page->swap_slot);
+		lock_release (&swap_lock);
+		anon_page->swap_slot = SWAP_SLOT_NONE;
+	}
 }
 
 /* Swap out the page by writing contents to the swap disk. */
 static bool
 anon_swap_out (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+	struct frame *frame = page->frame;
+
+	/* swap에 있는 사본과 내용이 같으면 쓸 필요가 없다. */
+	if (anon_page->swap_slot != SWAP_SLOT_NONE
+			&& !pml4_is_dirty (page->owner->pml4, page->va))
+		return true;
+
+	/* 압축 캐시에 넣었으면 디스크의 옛 사본은 더 이상 쓸모없다. */
+	if (vm_zswap && zswap_store (page, frame->kva)) {
+		anon_release_slot (page);
+		vm_stat_add (page->owner, swap_outs, 1);
+		return true;
+	}
+	if (!anon_write_slot (page, frame->kva))
+		return false;
+	vm_stat_add (page->owner, swap_outs, 1);
+	return true;
 }
 
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+
+	vm_free_frame (page);
+
+	/* frame을 놓은 뒤에는 eviction과 겹치지 않는다. 압축 캐시에서
+	 * 먼저 지워야 그 사이 디스크로 밀려나 슬롯이 새로 생기지 않는다. */
+	if (anon_page->zswap != NULL)
+		zswap_free (page);
+	anon_release_slot (page);
+}
+
+/* === project3 - Anonymous Memory === */
+/* 스택 영역 바로 아래부터 내려가며 LENGTH 바이트가 들어갈 빈 자리를
+ * 찾아 시작 주소를 반환한다. 힙 위쪽에서 자리를 찾지 못하면 NULL. */
+void *
+anon_find_area (size_t length) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	size_t page_cnt = DIV_ROUND_UP (length, PGSIZE);
+	uint8_t *top = (uint8_t *) USER_STACK - STACK_LIMIT;
+	uint8_t *bottom = spt->brk != NULL ? pg_round_up (spt->brk)
+		: (uint8_t *) PGSIZE;
+	size_t free_cnt = 0;
+
+	for (uint8_t *va = top - PGSIZE; va >= bottom; va -= PGSIZE) {
+		if (spt_find_page (spt, va) != NULL)
+			free_cnt = 0;
+		else if (++free_cnt == page_cnt)
+			return va;
+	}
+	return NULL;
+}
+
+/* ADDR부터 LENGTH 바이트를 0으로 채워질 익명 페이지로 매핑한다.
+ * 파일 매핑과 같이 do_munmap으로 해제한다. */
+void *
+do_mmap_anon (void *addr, size_t length, bool writable) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	size_t page_cnt = DIV_ROUND_UP (length, PGSIZE);
+	uint8_t *upage = addr;
+
+	for (size_t i = 0; i < page_cnt; i++)
+		if (!vm_alloc_page (VM_ANON, upage + i * PGSIZE, writable)) {
+			/* 이미 만든 페이지를 되돌린다. */
+			while (i-- > 0)
+				spt_remove_page (spt, spt_find_page (spt, upage + i * PGSIZE));
+			return NULL;
+		}
+
+	spt_find_page (spt, addr)->mmap_cnt = page_cnt;
+	return addr;
 }
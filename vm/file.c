@@ -1,6 +1,14 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
 #include "vm/vm.h"
+#include <round.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "filesys/page_cache.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/vaddr.h"
 
 static bool file_backed_swap_in (struct page *page, void *kva);
 static bool file_backed_swap_out (struct page *page);
@@ -26,33 +34,213 @@ file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
 	page->operations = &file_ops;
 
 	struct file_page *file_page = &page->file;
+	memset (file_page, 0, sizeof *file_page);
+	return true;
 }
 
 /* Swap in the page by read contents from the file. */
+/* 페이지 캐시에 있으면 복사해 오고, 없으면 디스크에서 읽어 이 frame을
+ * 캐시에 올린다. 그래서 read()와 mmap이 같은 내용을 본다. */
 static bool
 file_backed_swap_in (struct page *page, void *kva) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+	struct inode *inode = file_get_inode (file_page->file);
+
+	ASSERT (page->frame != NULL && page->frame->kva == kva);
+
+	if (!page_cache_load (inode, file_page->ofs, page->frame,
+				file_page->read_bytes)) {
+		unsigned long seq = page_cache_seq ();
+
+		if (inode_read_disk (inode, kva, file_page->read_bytes,
+					file_page->ofs) != (off_t) file_page->read_bytes)
+			return false;
+		page_cache_adopt (page->frame, inode, file_page->ofs,
+				file_page->read_bytes, seq);
+	}
+	memset ((uint8_t *) kva + file_page->read_bytes, 0, file_page->zero_bytes);
+	return true;
 }
 
 /* Swap out the page by writeback contents to the file. */
+static void file_backed_write_back (struct page *page);
+
 static bool
 file_backed_swap_out (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	/* 깨끗한 페이지는 파일에서 다시 읽으면 되므로 그냥 버린다. */
+	file_backed_write_back (page);
+	return true;
+}
+
+/* === project3 - Page Cache === */
+/* PAGE를 파일에 쓰기 전에, 같은 파일 페이지를 담은 다른 frame을 캐시에서
+ * 뺀다. 캐시에는 PAGE의 frame만 남으므로 쓰는 동안 read()도 새 내용을
+ * 본다. frame_lock을 잡은 상태여야 한다. */
+void
+file_backed_invalidate (struct page *page) {
+	struct file_page *file_page = &page->file;
+
+	page_cache_invalidate (file_get_inode (file_page->file), file_page->ofs,
+			page->frame);
+}
+
+/* PAGE의 내용 BUF를 파일에 쓴다. 캐시에 올라 있는 것은 PAGE의 frame
+ * 자신이므로 캐시를 거치지 않고 디스크에 바로 쓴다. cleaner가 뜬 사본으로
+ * 살아 있는 frame을 덮어쓰면 안 되기 때문이다.
+ * 호출자가 먼저 file_backed_invalidate를 불러 두어야 한다.
+ * 디스크에 쓰는 동안 frame_lock을 잡고 있지 않아도 된다. */
+static bool
+file_backed_write (struct page *page, const void *buf) {
+	struct file_page *file_page = &page->file;
+	struct inode *inode = file_get_inode (file_page->file);
+
+	return inode_write_disk (inode, buf, file_page->read_bytes,
+			file_page->ofs) == (off_t) file_page->read_bytes;
+}
+
+/* === project3 - Memory Mapped Files === */
+/* === project3 - WSClock === */
+/* cleaner가 떠 둔 PAGE의 사본 BUF를 파일에 써 둔다. */
+bool
+file_backed_clean (struct page *page, const void *buf) {
+	return file_backed_write (page, buf);
+}
+
+/* 변경된 내용이 있으면 파일에 다시 쓴다. */
+static void
+file_backed_write_back (struct page *page) {
+	if (page->frame == NULL || page->frame->owner->pml4 == NULL)
+		return;
+
+	uint64_t *pml4 = page->frame->owner->pml4;
+
+	if (pml4_is_dirty (pml4, page->va)) {
+		file_backed_write (page, page->frame->kva);
+		pml4_set_dirty (pml4, page->va, false);
+	}
+}
+
+/* === project3 - madvise === */
+/* 변경된 내용을 파일에 쓰고 PAGE의 frame을 놓는다.
+ * 다음 접근 때 파일에서 다시 읽는다. */
+void
+file_backed_drop (struct page *page) {
+	/* write back 도중 frame이 evict 되지 않도록 pin 해 두고, 쓰는 동안은
+	 * frame_lock을 놓는다. 그 뒤에 evict 되더라도 이미 깨끗하므로
+	 * 다시 쓰지 않는다. */
+	lock_acquire (&frame_lock);
+	struct frame *frame = vm_page_frame (page);
+	if (frame != NULL) {
+		file_backed_invalidate (page);
+		vm_frame_io_begin (frame);
+	}
+	lock_release (&frame_lock);
+
+	if (frame != NULL) {
+		file_backed_write_back (page);
+		lock_acquire (&frame_lock);
+		frame->pinned = false;
+		vm_frame_io_end (frame);
+		lock_release (&frame_lock);
+	}
+	vm_free_frame (page);
 }
 
 /* Destory the file backed page. PAGE will be freed by the caller. */
 static void
 file_backed_destroy (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+
+	file_backed_drop (page);
+	file_close (file_page->file);
+}
+
+/* 첫 fault 때 파일 내용을 읽어 페이지를 채운다. */
+static bool
+lazy_load_file (struct page *page, void *aux) {
+	struct lazy_load_arg *arg = aux;
+	struct file_page *file_page = &page->file;
+
+	file_page->file = arg->file;
+	file_page->ofs = arg->ofs;
+	file_page->read_bytes = arg->read_bytes;
+	file_page->zero_bytes = arg->zero_bytes;
+	free (arg);
+
+	return file_backed_swap_in (page, page->frame->kva);
 }
 
 /* Do the mmap */
 void *
 do_mmap (void *addr, size_t length, int writable,
 		struct file *file, off_t offset) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	off_t file_len = file_length (file);
+	size_t page_cnt = DIV_ROUND_UP (length, PGSIZE);
+	size_t read_bytes = offset < file_len ? file_len - offset : 0;
+	uint8_t *upage = addr;
+
+	if (read_bytes > length)
+		read_bytes = length;
+
+	for (size_t i = 0; i < page_cnt; i++) {
+		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
+		struct lazy_load_arg *arg = malloc (sizeof *arg);
+		if (arg == NULL)
+			goto fail;
+
+		/* 페이지마다 파일을 따로 열어 두면 munmap, exit 순서와 상관없이
+		 * 각 페이지가 자기 파일을 닫을 수 있다. */
+		arg->file = file_reopen (file);
+		arg->ofs = offset + i * PGSIZE;
+		arg->read_bytes = page_read_bytes;
+		arg->zero_bytes = PGSIZE - page_read_bytes;
+		if (arg->file == NULL) {
+			free (arg);
+			goto fail;
+		}
+		if (!vm_alloc_page_with_initializer (VM_FILE, upage + i * PGSIZE,
+					writable, lazy_load_file, arg)) {
+			file_close (arg->file);
+			free (arg);
+			goto fail;
+		}
+		read_bytes -= page_read_bytes;
+	}
+
+	spt_find_page (spt, addr)->mmap_cnt = page_cnt;
+	return addr;
+
+fail:
+	/* 이미 만든 페이지를 되돌린다. */
+	for (uint8_t *va = addr; va < upage + page_cnt * PGSIZE; va += PGSIZE) {
+		struct page *page = spt_find_page (spt, va);
+		if (page == NULL)
+			break;
+		spt_remove_page (spt, page);
+	}
+	return NULL;
+}
+
+/* spt_for_each 콜백: 매핑 페이지를 제거한다. */
+static bool
+munmap_page (struct page *page, void *spt) {
+	spt_remove_page (spt, page);
+	return true;
 }
 
 /* Do the munmap */
 void
 do_munmap (void *addr) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct page *page = spt_find_page (spt, addr);
+
+	if (page == NULL || page->va != addr || page->mmap_cnt == 0)
+		return;
+
+	void *end = (uint8_t *) addr + page->mmap_cnt * PGSIZE;
+
+	vm_unmap_begin (addr, end);
+	spt_for_each (spt, addr, end, munmap_page, spt);
+	vm_unmap_end ();
 }
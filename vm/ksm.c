@@ -0,0 +1,202 @@
+/* ksm.c: Merging anonymous pages with identical contents. */
+
+#include "vm/ksm.h"
+#include <hash.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/thread.h"
+#include "vm/vm.h"
+
+/* === project3 - Same-Page Merging === */
+/* ksmd가 깨어나는 간격(tick). 깨어날 때마다 vm_ksm개의 frame을 본다. */
+#define KSM_INTERVAL (TIMER_FREQ / 10)
+
+/* 이번 바퀴에 본 frame 하나. 내용의 checksum으로 찾는다.
+ * frame은 그 사이에 바뀌거나 해제될 수 있으므로 쓰기 전에 다시 확인한다. */
+struct ksm_item {
+	struct hash_elem elem;
+	uint64_t checksum;
+	struct frame *frame;
+};
+
+size_t vm_ksm;
+
+/* ksmd만 쓴다. 한 바퀴를 돌 때마다 비운다. */
+static struct hash ksm_table;
+static size_t ksm_hand;
+
+/* 통계 */
+static long long scan_cnt;      /* 살펴본 익명 frame 수 */
+static long long merge_cnt;     /* 합친 페이지 수 */
+
+static uint64_t
+ksm_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_entry (e, struct ksm_item, elem)->checksum;
+}
+
+static bool
+ksm_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct ksm_item, elem)->checksum
+		< hash_entry (b, struct ksm_item, elem)->checksum;
+}
+
+static void
+ksm_item_free (struct hash_elem *e, void *aux UNUSED) {
+	free (hash_entry (e, struct ksm_item, elem));
+}
+
+/* FRAME이 한 익명 페이지만 매핑한 frame이면 그 페이지를 반환한다.
+ * swap 캐시의 frame은 합치지 못했을 때 쓰기 권한을 되돌리면 슬롯과
+ * 내용이 달라질 수 있으므로 건너뛴다. frame_lock을 잡은 상태여야 한다. */
+static struct page *
+ksm_single (struct frame *frame) {
+	struct page *page = frame->page;
+
+	if (page == NULL || frame->pinned || frame->ref_cnt != 1
+			|| page->frame != frame
+			|| VM_TYPE (page->operations->type) != VM_ANON
+			|| page->anon.prefetched
+			|| frame->swap_slot != SWAP_SLOT_NONE
+			|| frame->owner == NULL || frame->owner->pml4 == NULL)
+		return NULL;
+	return page;
+}
+
+/* FRAME을 이미 여러 익명 페이지가 읽기 전용으로 함께 쓰고 있는지 확인한다.
+ * frame_lock을 잡은 상태여야 한다. */
+static bool
+ksm_shared (struct frame *frame) {
+	if (frame->ref_cnt < 2 || frame->pinned || frame->cache_inode != NULL)
+		return false;
+	return frame->page == NULL
+		|| VM_TYPE (frame->page->operations->type) == VM_ANON;
+}
+
+/* SRC의 내용이 DST와 같으면 SRC의 페이지를 DST에 읽기 전용으로
+ * 옮겨 매핑하고 SRC를 돌려준다. 합친 뒤의 DST는 fork로 공유 중인
+ * frame과 같아서, 먼저 쓰는 쪽이 vm_handle_wp에서 복사해 간다.
+ * 비교하는 동안 주인이 쓰지 못하도록 두 매핑을 먼저 읽기 전용으로
+ * 바꾼다. 그 사이 쓰려던 스레드는 vm_handle_wp에서 frame_lock을 기다린다.
+ * frame_lock을 잡은 상태여야 한다. */
+static bool
+ksm_merge (struct frame *dst, struct frame *src) {
+	struct page *src_page = src->page;
+	struct thread *src_owner = src->owner;
+	struct page *dst_page = dst->ref_cnt == 1 ? dst->page : NULL;
+
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	if (dst_page != NULL)
+		pml4_set_writable (dst->owner->pml4, dst_page->va, false);
+	pml4_set_writable (src_owner->pml4, src_page->va, false);
+
+	if (memcmp (dst->kva, src->kva, PGSIZE) != 0) {
+		if (dst_page != NULL)
+			pml4_set_writable (dst->owner->pml4, dst_page->va,
+					dst_page->writable);
+		pml4_set_writable (src_owner->pml4, src_page->va, src_page->writable);
+		return false;
+	}
+
+	/* 페이지 테이블은 이미 있으므로 다시 매핑하는 데 실패하지 않는다.
+	 * swap 슬롯의 사본이 낡았다는 표시는 새 매핑에도 남겨 둔다. */
+	bool dirty = pml4_is_dirty (src_owner->pml4, src_page->va);
+	pml4_clear_page (src_owner->pml4, src_page->va);
+	pml4_set_page (src_owner->pml4, src_page->va, dst->kva, false);
+	if (dirty)
+		pml4_set_dirty (src_owner->pml4, src_page->va, true);
+	frame_share (dst, src_page);
+	src_page->frame = dst;
+	frame_put (src, src_page);
+
+	vm_stat_add (src_owner, ksm_merges, 1);
+	merge_cnt++;
+	return true;
+}
+
+/* clock hand와 별개인 ksm_hand가 가리키는 frame 하나를 살펴본다.
+ * 지난 바퀴와 checksum이 같은 익명 frame만 합칠 후보로 삼는다.
+ * 자주 바뀌는 페이지는 합쳐 봐야 곧 다시 복사되기 때문이다. */
+static void
+ksm_scan_one (void) {
+	struct frame *frame = vm_frame_at (ksm_hand++);
+
+	if (frame == NULL) {
+		/* 한 바퀴를 다 돌았다. 해제된 frame이 남지 않도록 새로 시작한다. */
+		ksm_hand = 0;
+		hash_clear (&ksm_table, ksm_item_free);
+		return;
+	}
+
+	lock_acquire (&frame_lock);
+	bool shared = ksm_shared (frame);
+	if (!shared && ksm_single (frame) == NULL) {
+		lock_release (&frame_lock);
+		return;
+	}
+
+	scan_cnt++;
+	uint64_t checksum = hash_bytes (frame->kva, PGSIZE);
+	bool stable = checksum == frame->ksm_checksum;
+	frame->ksm_checksum = checksum;
+	if (!stable && !shared) {
+		lock_release (&frame_lock);
+		return;
+	}
+
+	struct ksm_item key;
+	key.checksum = checksum;
+	struct hash_elem *e = hash_find (&ksm_table, &key.elem);
+	if (e == NULL) {
+		struct ksm_item *item = malloc (sizeof *item);
+		if (item != NULL) {
+			item->checksum = checksum;
+			item->frame = frame;
+			hash_insert (&ksm_table, &item->elem);
+		}
+		lock_release (&frame_lock);
+		return;
+	}
+
+	/* 이미 공유 중인 쪽으로 합친다. 둘 다 공유 중이면 두지 않는다. */
+	struct ksm_item *item = hash_entry (e, struct ksm_item, elem);
+	struct frame *other = item->frame;
+	bool other_shared = other != frame && ksm_shared (other);
+	bool other_single = other != frame && ksm_single (other) != NULL;
+
+	if (!shared && (other_shared || other_single))
+		ksm_merge (other, frame);
+	else if (shared && other_single) {
+		if (ksm_merge (frame, other))
+			item->frame = frame;
+	} else if (!other_shared && !other_single)
+		item->frame = frame;
+	lock_release (&frame_lock);
+}
+
+/* 주기적으로 깨어나 frame table을 조금씩 훑는다. */
+static void
+ksmd (void *aux UNUSED) {
+	for (;;) {
+		timer_sleep (KSM_INTERVAL);
+		for (size_t i = 0; i < vm_ksm; i++)
+			ksm_scan_one ();
+	}
+}
+
+void
+ksm_init (void) {
+	hash_init (&ksm_table, ksm_hash, ksm_less, NULL);
+	ksm_hand = 0;
+	thread_create ("ksmd", PRI_DEFAULT, ksmd, NULL);
+}
+
+void
+ksm_print_stats (void) {
+	printf ("KSM: %lld frames scanned, %lld pages merged\n",
+			scan_cnt, merge_cnt);
+}
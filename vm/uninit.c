@@ -10,6 +10,8 @@
 
 #include "vm/vm.h"
 #include "vm/uninit.h"
+#include "filesys/file.h"
+#include "threads/malloc.h"
 
 static bool uninit_initialize (struct page *page, void *kva);
 static void uninit_destroy (struct page *page);
@@ -62,7 +64,15 @@ uninit_initialize (struct page *page, void *kva) {
  * PAGE will be freed by the caller. */
 static void
 uninit_destroy (struct page *page) {
-	struct uninit_page *uninit UNUSED = &page->uninit;
+	struct uninit_page *uninit = &page->uninit;
 	/* TODO: Fill this function.
 	 * TODO: If you don't have anything to do, just return. */
+	struct lazy_load_arg *arg = uninit->aux;
+	if (arg == NULL)
+		return;
+
+	/* mmap 페이지는 페이지마다 파일을 reopen 해두었으므로 여기서 닫는다. */
+	if (VM_TYPE (uninit->type) == VM_FILE)
+		file_close (arg->file);
+	free (arg);
 }
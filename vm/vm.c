@@ -1,8 +1,26 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
+#include "vm/zswap.h"
+#include "vm/ksm.h"
+#include "filesys/inode.h"
+#include "filesys/page_cache.h"
+
+static void frame_table_init (void);
+static void swap_cache_init (void);
+static void vm_cleaner_init (void);
+static void zero_frame_init (void);
+static void fault_around_init (void);
+static void vm_pageout_init (void);
 
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
@@ -16,6 +34,18 @@ vm_init (void) {
 	register_inspect_intr ();
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
+	frame_table_init ();
+	swap_cache_init ();
+	page_cache_init ();
+	zero_frame_init ();
+	fault_around_init ();
+	if (vm_zswap)
+		zswap_init ();
+	if (vm_wsclock)
+		vm_cleaner_init ();
+	vm_pageout_init ();
+	if (vm_ksm > 0)
+		ksm_init ();
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -32,10 +62,420 @@ page_get_type (struct page *page) {
 	}
 }
 
+/* === project3 - Frame Table === */
+/* user pool의 페이지 번호로 바로 인덱싱하는 frame 배열.
+ * user pool은 연속된 주소 구간이므로 kva만 알면 O(1)에 frame을 찾는다.
+ * page가 NULL인 칸은 비어 있거나 user pool 중간의 구멍이다. */
+struct lock frame_lock;
+static struct frame *frame_table;
+static size_t frame_cnt;
+static size_t clock_hand;
+
+/* frame의 I/O가 끝날 때마다 알린다. frame_lock과 함께 쓴다. */
+static struct condition frame_io_done;
+
+static void
+frame_table_init (void) {
+	uint8_t *base = palloc_user_base ();
+
+	lock_init (&frame_lock);
+	cond_init (&frame_io_done);
+	frame_cnt = palloc_user_page_cnt ();
+	frame_table = palloc_get_multiple (PAL_ASSERT | PAL_ZERO,
+			DIV_ROUND_UP (frame_cnt * sizeof *frame_table, PGSIZE));
+	for (size_t i = 0; i < frame_cnt; i++) {
+		frame_table[i].kva = base + i * PGSIZE;
+		frame_table[i].swap_slot = SWAP_SLOT_NONE;
+		list_init (&frame_table[i].sharers);
+	}
+	clock_hand = 0;
+}
+
+/* FRAME의 내용을 frame_lock 없이 디스크에 쓰기 시작한다. 그동안 frame은
+ * pinned이므로 clock과 ksmd가 건드리지 않는다.
+ * frame_lock을 잡은 상태여야 한다. */
+void
+vm_frame_io_begin (struct frame *frame) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	frame->pinned = true;
+	frame->io = true;
+}
+
+/* FRAME의 I/O가 끝났다. vm_page_frame에서 기다리던 스레드를 깨운다.
+ * pinned는 호출자가 정리한다. frame_lock을 잡은 상태여야 한다. */
+void
+vm_frame_io_end (struct frame *frame) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	frame->io = false;
+	cond_broadcast (&frame_io_done, &frame_lock);
+}
+
+/* PAGE의 frame을 반환한다. frame을 디스크에 쓰는 중이면 끝날 때까지
+ * 기다리며, 그 사이 쫓겨났으면 NULL을 반환한다. frame을 놓거나 다시
+ * 매핑하거나 내용을 읽기 전에 이것으로 얻어야 한다.
+ * frame_lock을 잡은 상태여야 한다. */
+struct frame *
+vm_page_frame (struct page *page) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	while (page->frame != NULL && page->frame->io)
+		cond_wait (&frame_io_done, &frame_lock);
+	return page->frame;
+}
+
+/* === project3 - Same-Page Merging === */
+/* IDX번째 frame을 반환한다. frame 수를 넘으면 NULL을 반환한다. */
+struct frame *
+vm_frame_at (size_t idx) {
+	return idx < frame_cnt ? &frame_table[idx] : NULL;
+}
+
+/* user pool 페이지 KVA에 해당하는 frame을 반환한다. */
+static struct frame *
+frame_lookup (void *kva) {
+	size_t idx = pg_no (kva) - pg_no (palloc_user_base ());
+
+	ASSERT (idx < frame_cnt);
+	return &frame_table[idx];
+}
+
+/* === project3 - Zero Page === */
+/* 모든 프로세스가 읽기 전용으로 공유하는 0으로 채워진 frame.
+ * frame table 밖에 있으므로 clock이 보지 않는다. ref_cnt에 커널 몫 1이
+ * 들어 있어 0이 되지 않으므로, 매핑한 페이지는 일반 공유 frame과 같이
+ * 다뤄지고 첫 쓰기 때 vm_handle_wp에서 자기 frame을 받는다. */
+static struct frame zero_frame;
+
+static void
+zero_frame_init (void) {
+	zero_frame.kva = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+	zero_frame.ref_cnt = 1;
+	list_init (&zero_frame.sharers);
+}
+
+/* 아직 접근하지 않은 PAGE가 0으로만 채워질 익명 페이지인지 확인한다.
+ * 익명 페이지의 aux는 NULL이거나 load_segment의 lazy_load_arg이다. */
+static bool
+vm_is_zero_fill (struct page *page) {
+	if (VM_TYPE (page->operations->type) != VM_UNINIT
+			|| VM_TYPE (page->uninit.type) != VM_ANON)
+		return false;
+
+	struct lazy_load_arg *arg = page->uninit.aux;
+	return arg == NULL ? page->uninit.init == NULL : arg->read_bytes == 0;
+}
+
+/* 읽기 fault가 난 zero-fill PAGE를 frame 없이 익명 페이지로 바꾸고
+ * zero frame에 읽기 전용으로 매핑한다. */
+static bool
+vm_map_zero_page (struct page *page) {
+	free (page->uninit.aux);
+	anon_initializer (page, page->uninit.type, NULL);
+
+	lock_acquire (&frame_lock);
+	zero_frame.ref_cnt++;
+	page->frame = &zero_frame;
+	lock_release (&frame_lock);
+
+	return pml4_set_page (thread_current ()->pml4, page->va,
+			zero_frame.kva, false);
+}
+
+/* === project3 - VM Statistics === */
+struct vm_stats vm_stats;
+
+/* T의 페이지가 FRAME을 얻거나(DELTA = 1) 놓았다(DELTA = -1).
+ * 모두가 공유하는 zero frame은 RSS에 세지 않는다. */
+static void
+vm_rss_add (struct thread *t, struct frame *frame, int delta) {
+	if (frame == &zero_frame)
+		return;
+
+	vm_stat_add (t, rss, delta);
+	if (t->spt.stats.rss > t->spt.stats.peak_rss)
+		t->spt.stats.peak_rss = t->spt.stats.rss;
+	if (vm_stats.rss > vm_stats.peak_rss)
+		vm_stats.peak_rss = vm_stats.rss;
+}
+
+/* PAGE에 난 fault를 처리하려면 디스크를 읽어야 하는지 확인한다. */
+static bool
+vm_fault_is_major (struct page *page) {
+	if (page->frame != NULL)
+		return false;
+
+	switch (VM_TYPE (page->operations->type)) {
+		case VM_UNINIT:
+			return !vm_is_zero_fill (page)
+				&& (page->uninit.aux != NULL || page->uninit.init != NULL);
+		case VM_ANON:
+			return page->anon.zswap == NULL
+				&& page->anon.swap_slot != SWAP_SLOT_NONE;
+		default:
+			return true;
+	}
+}
+
+/* T가 PAGE에서 낸 fault를 센다. */
+static void
+vm_stat_fault (struct thread *t, struct page *page) {
+	vm_stat_add (t, faults, 1);
+	if (vm_fault_is_major (page))
+		vm_stat_add (t, major_faults, 1);
+	else
+		vm_stat_add (t, minor_faults, 1);
+
+	switch (VM_TYPE (page->operations->type)) {
+		case VM_UNINIT:
+			vm_stat_add (t, uninit_faults, 1);
+			break;
+		case VM_ANON:
+			vm_stat_add (t, anon_faults, 1);
+			break;
+		default:
+			vm_stat_add (t, file_faults, 1);
+			break;
+	}
+}
+
+/* Prints virtual memory statistics. */
+void
+vm_print_stats (void) {
+	const struct vm_stats *st = &vm_stats;
+
+	printf ("VM: %lld faults (%lld minor, %lld major), "
+			"%lld uninit, %lld anon, %lld file\n",
+			st->faults, st->minor_faults, st->major_faults,
+			st->uninit_faults, st->anon_faults, st->file_faults);
+	printf ("VM: %lld evictions, %lld swap-ins, %lld swap-outs, "
+			"%lld COW copies, %lld stack growths\n",
+			st->evictions, st->swap_ins, st->swap_outs,
+			st->cow_copies, st->stack_growths);
+	printf ("VM: %lld readahead pages (%lld used), "
+			"%lld fault-around pages (window %zu), %lld huge pages\n",
+			st->readahead_pages, st->readahead_hits,
+			st->fault_around_pages, vm_fault_around, st->huge_maps);
+	printf ("VM: %lld resident pages, peak %lld\n", st->rss, st->peak_rss);
+	printf ("VM: %lld page cache hits, %lld misses\n",
+			st->cache_hits, st->cache_misses);
+	if (vm_zswap)
+		zswap_print_stats ();
+	if (vm_ksm > 0)
+		ksm_print_stats ();
+}
+
+/* === project3 - Copy On Write === */
+/* swap 슬롯으로 frame을 찾는 색인. fork나 ksmd로 함께 매핑되던 frame을
+ * 내보내면 모든 페이지가 슬롯 하나를 가리킨다. 그중 한 페이지가 읽어 온
+ * frame을 여기 올려 두면, 같은 슬롯을 가리키는 다른 페이지는 디스크를
+ * 읽지 않고 그 frame을 다시 함께 매핑한다. frame_lock으로 보호한다. */
+static struct hash swap_cache;
+
+static uint64_t
+swap_cache_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_int (hash_entry (e, struct frame, swap_elem)->swap_slot);
+}
+
+static bool
+swap_cache_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct frame, swap_elem)->swap_slot
+		< hash_entry (b, struct frame, swap_elem)->swap_slot;
+}
+
+static void
+swap_cache_init (void) {
+	hash_init (&swap_cache, swap_cache_hash, swap_cache_less, NULL);
+}
+
+/* SLOT의 내용을 담은 frame을 찾는다. frame_lock을 잡은 상태여야 한다. */
+static struct frame *
+swap_cache_lookup (size_t slot) {
+	struct frame key;
+	struct hash_elem *e;
+
+	key.swap_slot = slot;
+	e = hash_find (&swap_cache, &key.swap_elem);
+	return e != NULL ? hash_entry (e, struct frame, swap_elem) : NULL;
+}
+
+/* FRAME을 색인에서 뺀다. frame을 놓거나 내보낼 때, 그리고 쓰기를 허락해
+ * 슬롯과 내용이 달라질 수 있을 때 부른다. frame_lock을 잡은 상태여야 한다. */
+static void
+swap_cache_remove (struct frame *frame) {
+	if (frame->swap_slot != SWAP_SLOT_NONE) {
+		hash_delete (&swap_cache, &frame->swap_elem);
+		frame->swap_slot = SWAP_SLOT_NONE;
+	}
+}
+
+/* PAGE가 가리키는 슬롯을 다른 페이지가 이미 읽어 와 매핑하고 있으면 그
+ * frame을 읽기 전용으로 함께 매핑하고 true를 반환한다. 먼저 쓰는 쪽은
+ * vm_handle_wp에서 복사해 간다. */
+static bool
+vm_map_swap_cached (struct page *page) {
+	struct thread *curr = thread_current ();
+
+	if (VM_TYPE (page->operations->type) != VM_ANON || page->frame != NULL
+			|| page->anon.swap_slot == SWAP_SLOT_NONE)
+		return false;
+
+	/* 내보내는 중인 frame은 곧 떠나므로 함께 매핑하지 않는다. */
+	lock_acquire (&frame_lock);
+	struct frame *frame = swap_cache_lookup (page->anon.swap_slot);
+	if (frame == NULL || frame->io) {
+		lock_release (&frame_lock);
+		return false;
+	}
+	frame_share (frame, page);
+	page->frame = frame;
+	vm_rss_add (curr, frame, 1);
+	bool success = pml4_set_page (curr->pml4, page->va, frame->kva, false);
+	lock_release (&frame_lock);
+	return success;
+}
+
+/* 여러 페이지가 함께 가리키는 슬롯에서 PAGE를 막 읽어 왔으면 frame을
+ * 색인에 올리고 읽기 전용으로 바꾼다. frame은 아직 pinned여야 한다. */
+static void
+vm_swap_cache_add (struct page *page) {
+	if (VM_TYPE (page->operations->type) != VM_ANON
+			|| page->anon.swap_slot == SWAP_SLOT_NONE
+			|| !anon_slot_shared (page->anon.swap_slot))
+		return;
+
+	size_t slot = page->anon.swap_slot;
+
+	lock_acquire (&frame_lock);
+	struct frame *frame = page->frame;
+	if (frame->swap_slot == SWAP_SLOT_NONE && swap_cache_lookup (slot) == NULL) {
+		frame->swap_slot = slot;
+		hash_insert (&swap_cache, &frame->swap_elem);
+		pml4_set_writable (thread_current ()->pml4, page->va, false);
+	}
+	lock_release (&frame_lock);
+}
+
+/* === project3 - WSClock === */
+bool vm_wsclock;
+
+/* cleaner에게 넘길 dirty frame 큐. frame_lock으로 보호한다.
+ * 가득 차면 더 넣지 않는다. 다음 바퀴에서 다시 만나게 된다. */
+#define CLEAN_QUEUE_SIZE 64
+static struct frame *clean_queue[CLEAN_QUEUE_SIZE];
+static size_t clean_head;
+static size_t clean_cnt;
+static struct semaphore clean_sema;
+
+/* PAGE를 내보내려면 디스크에 써야 하는지 확인한다.
+ * 파일 페이지는 dirty일 때, 익명 페이지는 dirty이거나
+ * 아직 swap에 사본이 없을 때 써야 한다. */
+static bool
+vm_page_needs_write (struct page *page) {
+	if (pml4_is_dirty (page->owner->pml4, page->va))
+		return true;
+	return page_get_type (page) == VM_ANON
+		&& page->anon.swap_slot == SWAP_SLOT_NONE;
+}
+
+/* FRAME을 내보내려면 디스크에 써야 하는지 확인한다. 함께 매핑한 페이지
+ * 중 하나라도 사본이 낡았으면 한 번은 써야 한다. */
+static bool
+vm_frame_needs_write (struct frame *frame) {
+	if (vm_page_needs_write (frame->page))
+		return true;
+
+	for (struct list_elem *e = list_begin (&frame->sharers);
+			e != list_end (&frame->sharers); e = list_next (e))
+		if (vm_page_needs_write (list_entry (e, struct page, share_elem)))
+			return true;
+	return false;
+}
+
+/* FRAME을 cleaner 큐에 넣는다. frame_lock을 잡은 상태여야 한다. */
+static void
+vm_queue_clean (struct frame *frame) {
+	if (frame->queued || clean_cnt == CLEAN_QUEUE_SIZE)
+		return;
+
+	frame->queued = true;
+	clean_queue[(clean_head + clean_cnt) % CLEAN_QUEUE_SIZE] = frame;
+	clean_cnt++;
+	sema_up (&clean_sema);
+}
+
+/* 큐에 들어온 dirty frame을 디스크에 미리 써서 깨끗하게 만든다.
+ * 매핑을 유지한 채로 쓰므로, 인터럽트를 끈 채 dirty 비트를 지우고
+ * 사본을 뜬다. 그 뒤에 주인이 쓰면 dirty 비트가 다시 켜진다.
+ * 사본을 쓰는 동안에는 frame을 pin 해 두고 frame_lock을 놓으므로,
+ * eviction과 다른 fault는 이 쓰기를 기다리지 않는다. */
+static void
+vm_cleaner (void *aux UNUSED) {
+	uint8_t *buf = palloc_get_page (PAL_ASSERT);
+
+	for (;;) {
+		sema_down (&clean_sema);
+		lock_acquire (&frame_lock);
+
+		struct frame *frame = clean_queue[clean_head];
+		clean_head = (clean_head + 1) % CLEAN_QUEUE_SIZE;
+		clean_cnt--;
+		frame->queued = false;
+
+		/* 큐에 있는 동안 해제되었거나 이미 깨끗해졌을 수 있다. */
+		if (frame->page == NULL || frame->pinned || frame->ref_cnt != 1
+				|| !vm_frame_needs_write (frame)) {
+			lock_release (&frame_lock);
+			continue;
+		}
+
+		struct page *page = frame->page;
+		uint64_t *pml4 = frame->owner->pml4;
+		bool success;
+
+		enum intr_level old_level = intr_disable ();
+		pml4_set_dirty (pml4, page->va, false);
+		memcpy (buf, frame->kva, PGSIZE);
+		intr_set_level (old_level);
+		if (page_get_type (page) == VM_FILE)
+			file_backed_invalidate (page);
+		vm_frame_io_begin (frame);
+		lock_release (&frame_lock);
+
+		if (page_get_type (page) == VM_ANON)
+			success = anon_clean (page, buf);
+		else
+			success = file_backed_clean (page, buf);
+
+		/* 쓰는 동안 frame은 pin 되어 있었으므로 PAGE와 주인은 그대로다. */
+		lock_acquire (&frame_lock);
+		if (!success)
+			pml4_set_dirty (pml4, page->va, true);
+		frame->pinned = false;
+		vm_frame_io_end (frame);
+		lock_release (&frame_lock);
+	}
+}
+
+static void
+vm_cleaner_init (void) {
+	sema_init (&clean_sema, 0);
+	clean_head = clean_cnt = 0;
+	thread_create ("vm_cleaner", PRI_DEFAULT, vm_cleaner, NULL);
+}
+
 /* Helpers */
 static struct frame *vm_get_victim (void);
+static bool vm_frame_test_accessed (struct frame *frame);
+static bool vm_evict_shared (struct frame *frame);
 static bool vm_do_claim_page (struct page *page);
 static struct frame *vm_evict_frame (void);
+static void vm_readahead_miss (struct frame *frame);
+static void free_batch_add (void *kva);
+static void vm_evict_behind (struct page *page);
+static bool vm_anon_reset (struct page *page);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -53,91 +493,1118 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		/* TODO: Create the page, fetch the initialier according to the VM type,
 		 * TODO: and then create "uninit" page struct by calling uninit_new. You
 		 * TODO: should modify the field after calling the uninit_new. */
+		bool (*initializer)(struct page *, enum vm_type, void *);
+		switch (VM_TYPE (type)) {
+			case VM_ANON:
+				initializer = anon_initializer;
+				break;
+			case VM_FILE:
+				initializer = file_backed_initializer;
+				break;
+			default:
+				goto err;
+		}
+
+		struct page *page = malloc (sizeof *page);
+		if (page == NULL)
+			goto err;
+
+		uninit_new (page, upage, init, type, aux, initializer);
+		page->writable = writable;
+		page->mmap_cnt = 0;
+		page->advice = MADV_NORMAL;
+		/* 익명 페이지의 aux는 load_segment의 lazy_load_arg뿐이다. */
+		page->seg_init = NULL;
+		if (VM_TYPE (type) == VM_ANON && aux != NULL) {
+			struct lazy_load_arg *arg = aux;
+			page->seg_init = init;
+			page->seg_ofs = arg->ofs;
+			page->seg_read_bytes = arg->read_bytes;
+		}
 
 		/* TODO: Insert the page into the spt. */
+		if (!spt_insert_page (spt, page)) {
+			free (page);
+			goto err;
+		}
+		return true;
 	}
 err:
 	return false;
 }
 
+/* === project3 - Supplemental Page Table === */
+/* 각 단계 노드의 인덱스가 시작하는 비트 위치.
+ * threads/pte.h의 PML4/PDPE/PDX/PTX와 같은 순서이다. */
+static const unsigned spt_shift[] = { PML4SHIFT, PDPESHIFT, PDXSHIFT, PTXSHIFT };
+#define SPT_LEVELS 4
+#define SPT_FANOUT (PGSIZE / sizeof (void *))
+
+/* VA에 해당하는 leaf 슬롯의 주소를 반환한다.
+ * CREATE가 true면 중간 노드가 없을 때 새로 만든다.
+ * 슬롯을 찾을 수 없으면 NULL을 반환한다. */
+static struct page **
+spt_walk (struct supplemental_page_table *spt, const void *va, bool create) {
+	uint64_t key = (uint64_t) va >> PDXSHIFT;
+
+	/* 마지막으로 찾은 leaf와 같은 2MB 구간이면 바로 반환 */
+	if (spt->hint_leaf != NULL && spt->hint_key == key)
+		return &spt->hint_leaf[PTX (va)];
+
+	if (spt->root == NULL) {
+		if (!create)
+			return NULL;
+		spt->root = palloc_get_page (PAL_ZERO);
+		if (spt->root == NULL)
+			return NULL;
+	}
+
+	void **node = spt->root;
+	for (int level = 0; level < SPT_LEVELS - 1; level++) {
+		unsigned idx = ((uint64_t) va >> spt_shift[level]) & (SPT_FANOUT - 1);
+		void **child = node[idx];
+		if (child == NULL) {
+			if (!create)
+				return NULL;
+			child = palloc_get_page (PAL_ZERO);
+			if (child == NULL)
+				return NULL;
+			node[idx] = child;
+		}
+		node = child;
+	}
+
+	spt->hint_leaf = (struct page **) node;
+	spt->hint_key = key;
+	return &spt->hint_leaf[PTX (va)];
+}
+
 /* Find VA from spt and return page. On error, return NULL. */
 struct page *
-spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
-	struct page *page = NULL;
-	/* TODO: Fill this function. */
+spt_find_page (struct supplemental_page_table *spt, void *va) {
+	if (va == NULL || is_kernel_vaddr (va))
+		return NULL;
 
-	return page;
+	struct page **slot = spt_walk (spt, pg_round_down (va), false);
+	return slot != NULL ? *slot : NULL;
 }
 
 /* Insert PAGE into spt with validation. */
 bool
-spt_insert_page (struct supplemental_page_table *spt UNUSED,
-		struct page *page UNUSED) {
-	int succ = false;
-	/* TODO: Fill this function. */
+spt_insert_page (struct supplemental_page_table *spt,
+		struct page *page) {
+	if (page->va == NULL || is_kernel_vaddr (page->va)
+			|| pg_ofs (page->va) != 0)
+		return false;
+
+	struct page **slot = spt_walk (spt, page->va, true);
+	if (slot == NULL || *slot != NULL)
+		return false;
 
-	return succ;
+	*slot = page;
+	spt->page_cnt++;
+	page->owner = thread_current ();
+	return true;
 }
 
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
+	struct page **slot = spt_walk (spt, page->va, false);
+	if (slot != NULL && *slot == page) {
+		*slot = NULL;
+		spt->page_cnt--;
+	}
 	vm_dealloc_page (page);
+}
+
+/* NODE(LEVEL 단계, BASE부터 시작하는 구간) 아래에서 [START, END)와
+ * 겹치는 페이지마다 FUNC를 호출한다. 비어 있는 하위 트리는 건너뛴다. */
+static bool
+spt_node_for_each (void **node, int level, uint64_t base,
+		uint64_t start, uint64_t end, spt_for_each_func *func, void *aux) {
+	unsigned shift = spt_shift[level];
+
+	for (unsigned i = 0; i < SPT_FANOUT; i++) {
+		uint64_t lo = base + ((uint64_t) i << shift);
+		uint64_t hi = lo + (1UL << shift);
+		if (hi <= start)
+			continue;
+		if (lo >= end)
+			break;
+
+		void *child = node[i];
+		if (child == NULL)
+			continue;
+
+		if (level == SPT_LEVELS - 1) {
+			if (!func ((struct page *) child, aux))
+				return false;
+		} else if (!spt_node_for_each (child, level + 1, lo, start, end,
+					func, aux))
+			return false;
+	}
 	return true;
 }
 
+/* [START, END) 구간에 등록된 페이지마다 주소 순서대로 FUNC를 호출한다.
+ * FUNC가 false를 반환하면 멈추고 false를 반환한다. */
+bool
+spt_for_each (struct supplemental_page_table *spt, void *start, void *end,
+		spt_for_each_func *func, void *aux) {
+	if (spt->root == NULL || start >= end)
+		return true;
+	return spt_node_for_each (spt->root, 0, 0, (uint64_t) start,
+			(uint64_t) end, func, aux);
+}
+
+/* LEVEL 단계의 NODE와 그 아래 노드들을 모두 해제한다. */
+static void
+spt_node_destroy (void **node, int level) {
+	if (level < SPT_LEVELS - 1)
+		for (unsigned i = 0; i < SPT_FANOUT; i++)
+			if (node[i] != NULL)
+				spt_node_destroy (node[i], level + 1);
+	palloc_free_page (node);
+}
+
+/* === project3 - Copy On Write === */
+/* FRAME을 매핑한 페이지 중 하나라도 accessed 비트가 켜져 있으면 모두
+ * 끄고 true를 반환한다. frame_lock을 잡은 상태에서 호출해야 한다. */
+static bool
+vm_frame_test_accessed (struct frame *frame) {
+	struct page *page = frame->page;
+	bool accessed = false;
+
+	if (page != NULL && pml4_is_accessed (frame->owner->pml4, page->va)) {
+		pml4_set_accessed (frame->owner->pml4, page->va, false);
+		accessed = true;
+	}
+	for (struct list_elem *e = list_begin (&frame->sharers);
+			e != list_end (&frame->sharers); e = list_next (e)) {
+		page = list_entry (e, struct page, share_elem);
+		if (pml4_is_accessed (page->owner->pml4, page->va)) {
+			pml4_set_accessed (page->owner->pml4, page->va, false);
+			accessed = true;
+		}
+	}
+	return accessed;
+}
+
+/* === project3 - Shared Text === */
+/* 실행 파일 페이지로 FRAME을 매핑하는 중인 페이지가 있는지 확인한다.
+ * vm_map_shared_text가 매핑을 마칠 때까지 그 페이지는 VM_UNINIT으로
+ * 남아 있으므로, 그동안은 FRAME을 내보내지 않는다.
+ * frame_lock을 잡은 상태에서 호출해야 한다. */
+static bool
+vm_text_settling (struct frame *frame) {
+	for (struct list_elem *e = list_begin (&frame->sharers);
+			e != list_end (&frame->sharers); e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, share_elem);
+		if (VM_TYPE (page->operations->type) == VM_UNINIT)
+			return true;
+	}
+	return false;
+}
+
+/* 실행 파일 페이지로 FRAME을 매핑한 페이지들의 매핑을 모두 끊는다.
+ * 읽기 전용이라 쓸 것이 없으므로 실패하지 않는다. 매핑을 잃은 페이지는
+ * frame도 swap 사본도 없는 익명 페이지로 남고, 다음 fault 때 실행
+ * 파일에서 다시 읽는다. frame_lock을 잡은 상태에서 호출해야 한다. */
+static void
+vm_evict_text (struct frame *frame) {
+	while (!list_empty (&frame->sharers)) {
+		struct page *page = list_entry (list_pop_front (&frame->sharers),
+				struct page, share_elem);
+		pml4_clear_page (page->owner->pml4, page->va);
+		vm_stat_add (page->owner, evictions, 1);
+		vm_rss_add (page->owner, frame, -1);
+		page->frame = NULL;
+		frame->ref_cnt--;
+	}
+	ASSERT (frame->ref_cnt == 1);
+}
+
 /* Get the struct frame, that will be evicted. */
+/* clock(second chance) 알고리즘: hand가 가리키는 frame의 accessed 비트가
+ * 켜져 있으면 끄고 넘어가고, 꺼져 있으면 그 frame을 고른다.
+ * 한 바퀴 안에 모든 비트가 꺼지므로 최대 두 바퀴면 끝난다.
+ * WSClock 모드에서는 디스크에 써야 하는 frame은 cleaner에게 넘기고
+ * 건너뛰며, 두 바퀴 안에 깨끗한 frame이 없을 때만 처음 만난 dirty
+ * frame을 고른다.
+ * frame_lock을 잡은 상태에서 호출해야 한다. */
 static struct frame *
 vm_get_victim (void) {
 	struct frame *victim = NULL;
+	struct frame *dirty_victim = NULL;
 	 /* TODO: The policy for eviction is up to you. */
+	ASSERT (lock_held_by_current_thread (&frame_lock));
 
-	return victim;
+	for (size_t i = 0; i < 2 * frame_cnt && victim == NULL; i++) {
+		struct frame *frame = &frame_table[clock_hand];
+		clock_hand = (clock_hand + 1) % frame_cnt;
+
+		/* 캐시에만 있는 frame은 디스크와 내용이 같으므로 쓰지 않고 버린다.
+		 * 실행 파일 페이지로 함께 매핑된 frame도 읽기 전용이라 깨끗하므로,
+		 * 매핑을 모두 끊고 버린다. */
+		if (page_cache_only (frame)) {
+			bool accessed = vm_frame_test_accessed (frame)
+				|| frame->cache_accessed;
+			frame->cache_accessed = false;
+			if (!accessed && !frame->pinned && !vm_text_settling (frame))
+				victim = frame;
+			continue;
+		}
+
+		if (frame->page == NULL || frame->pinned)
+			continue;
+
+		if (vm_frame_test_accessed (frame))
+			continue;
+		if (!vm_wsclock || !vm_frame_needs_write (frame))
+			victim = frame;
+		else {
+			if (dirty_victim == NULL)
+				dirty_victim = frame;
+			vm_queue_clean (frame);
+		}
+	}
+
+	return victim != NULL ? victim : dirty_victim;
+}
+
+/* === project3 - Clustered Swap Out === */
+/* swap에 써야 하는 익명 페이지 VICTIM과 함께, clock이 이어서 고를
+ * 익명 dirty frame을 SWAP_CLUSTER개까지 FRAMES에 모으고 연속된 슬롯을
+ * 잡아 *SLOT에 기록한다. 함께 내보낼 frame은 매핑을 끊고 I/O 중으로
+ * 표시해 둔다. VICTIM은 호출자가 처리한다.
+ * 모은 frame 수를 반환한다. 슬롯을 잡지 못하면 아무것도 바꾸지 않고
+ * 0을 반환한다. frame_lock을 잡은 상태에서 호출해야 한다. */
+static size_t
+vm_swap_cluster_begin (struct frame *victim, struct frame **frames,
+		size_t *slot) {
+	size_t cnt = 0;
+
+	frames[cnt++] = victim;
+	for (size_t i = 0; i < 2 * SWAP_CLUSTER && cnt < SWAP_CLUSTER; i++) {
+		struct frame *frame = &frame_table[clock_hand];
+		if (frame == victim)
+			break;
+		clock_hand = (clock_hand + 1) % frame_cnt;
+
+		if (frame->page == NULL || frame->pinned || frame->ref_cnt > 1)
+			continue;
+
+		uint64_t *pml4 = frame->owner->pml4;
+		if (pml4_is_accessed (pml4, frame->page->va))
+			pml4_set_accessed (pml4, frame->page->va, false);
+		else if (page_get_type (frame->page) == VM_ANON
+				&& vm_frame_needs_write (frame))
+			frames[cnt++] = frame;
+	}
+
+	*slot = anon_reserve_slots (cnt);
+	if (*slot == SWAP_SLOT_NONE && cnt > 1) {
+		cnt = 1;
+		*slot = anon_reserve_slots (cnt);
+	}
+	if (*slot == SWAP_SLOT_NONE)
+		return 0;
+
+	for (size_t i = 1; i < cnt; i++) {
+		pml4_clear_page (frames[i]->owner->pml4, frames[i]->page->va);
+		vm_frame_io_begin (frames[i]);
+	}
+	return cnt;
+}
+
+/* vm_swap_cluster_begin으로 모아 swap에 쓴 FRAMES[1..CNT)를 user pool로
+ * 돌려준다. 그래서 이어지는 fault는 eviction 없이 frame을 얻는다.
+ * frame_lock을 잡은 상태에서 호출해야 한다. */
+static void
+vm_swap_cluster_end (struct frame **frames, size_t cnt) {
+	for (size_t i = 1; i < cnt; i++) {
+		vm_stat_add (frames[i]->owner, evictions, 1);
+		vm_rss_add (frames[i]->owner, frames[i], -1);
+		frames[i]->page->frame = NULL;
+		frames[i]->page = NULL;
+		frames[i]->owner = NULL;
+		frames[i]->ref_cnt = 0;
+		frames[i]->pinned = false;
+		vm_frame_io_end (frames[i]);
+		palloc_free_page (frames[i]->kva);
+	}
+}
+
+/* === project3 - Copy On Write === */
+/* fork나 ksmd로 여러 페이지가 함께 매핑한 FRAME을 내보낸다. 먼저 매핑을
+ * 모두 끊는다. 사본이 낡은 페이지가 있으면 frame을 슬롯 하나에 한 번만
+ * 쓰고, 그 페이지들이 모두 이 슬롯을 가리키게 한다. 그중 한 페이지가
+ * 다시 읽어 오면 나머지는 swap 캐시에서 그 frame을 함께 매핑한다.
+ * 깨끗한 사본이 있는 페이지는 자기 슬롯을 그대로 쓴다. 쓰는 동안은
+ * frame_lock을 놓는다. 슬롯을 잡지 못하면 매핑을 되돌리고 그중 하나를
+ * 대표로 세운 뒤 false를 반환한다.
+ * frame_lock을 잡은 상태에서 호출해야 하며, 돌아올 때도 잡고 있다. */
+static bool
+vm_evict_shared (struct frame *frame) {
+	struct list *sharers = &frame->sharers;
+	struct list_elem *e;
+	size_t slot = SWAP_SLOT_NONE;
+	bool needs_write = false;
+
+	list_push_front (sharers, &frame->page->share_elem);
+	for (e = list_begin (sharers); e != list_end (sharers); e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, share_elem);
+		pml4_clear_page (page->owner->pml4, page->va);
+		needs_write = needs_write || vm_page_needs_write (page);
+	}
+
+	if (needs_write) {
+		slot = anon_reserve_slots (1);
+		if (slot == SWAP_SLOT_NONE) {
+			for (e = list_begin (sharers); e != list_end (sharers);
+					e = list_next (e)) {
+				struct page *page = list_entry (e, struct page, share_elem);
+				pml4_set_page (page->owner->pml4, page->va, frame->kva, false);
+			}
+			frame->page = list_entry (list_pop_front (sharers),
+					struct page, share_elem);
+			frame->owner = frame->page->owner;
+			return false;
+		}
+
+		/* 매핑을 모두 끊었고 frame을 pin 해 두었으므로 sharers는
+		 * 쓰는 동안 바뀌지 않는다. */
+		vm_frame_io_begin (frame);
+		lock_release (&frame_lock);
+		anon_write_shared (slot, frame->kva);
+		lock_acquire (&frame_lock);
+		vm_stat_add (frame->owner, swap_outs, 1);
+	}
+
+	while (!list_empty (sharers)) {
+		struct page *page = list_entry (list_pop_front (sharers),
+				struct page, share_elem);
+		if (vm_page_needs_write (page))
+			anon_attach_slot (page, slot);
+		vm_stat_add (page->owner, evictions, 1);
+		vm_rss_add (page->owner, frame, -1);
+		page->frame = NULL;
+		frame->ref_cnt--;
+	}
+	if (needs_write)
+		vm_frame_io_end (frame);
+	return true;
+}
+
+/* 한 페이지만 매핑한 VICTIM을 내보낸다. 매핑을 끊고 I/O 중으로 표시한
+ * 뒤 frame_lock을 놓고 디스크에 쓰므로, 그동안 다른 fault나 munmap은
+ * 이 쓰기를 기다리지 않는다. 이 frame을 놓거나 다시 매핑하려는 스레드만
+ * vm_page_frame에서 기다린다. 쓰지 못하면 frame을 매핑하지 않은 채
+ * 페이지에 붙여 두고 false를 반환한다. 다시 접근하면 vm_map_prefetched가
+ * 매핑한다. frame_lock을 잡은 상태에서 호출해야 하며, 돌아올 때도
+ * 잡고 있다. */
+static bool
+vm_evict_page (struct frame *victim) {
+	struct page *page = victim->page;
+	uint64_t *pml4 = victim->owner->pml4;
+	struct frame *frames[SWAP_CLUSTER];
+	size_t slot = SWAP_SLOT_NONE;
+	size_t cnt = 0;
+	bool success;
+
+	vm_readahead_miss (victim);
+	/* 압축 캐시를 쓰면 디스크에 묶어 쓰지 않고 swap_out에 맡긴다. */
+	if (!vm_zswap && page_get_type (page) == VM_ANON
+			&& vm_frame_needs_write (victim))
+		cnt = vm_swap_cluster_begin (victim, frames, &slot);
+
+	/* 먼저 매핑을 끊어야 내보내는 동안 주인이 내용을 바꾸지 못한다.
+	 * dirty 비트는 PTE에 남아 있으므로 swap_out에서 확인할 수 있다. */
+	pml4_clear_page (pml4, page->va);
+	if (page_get_type (page) == VM_FILE && pml4_is_dirty (pml4, page->va))
+		file_backed_invalidate (page);
+	vm_frame_io_begin (victim);
+	lock_release (&frame_lock);
+
+	if (cnt > 0) {
+		struct page *pages[SWAP_CLUSTER];
+
+		for (size_t i = 0; i < cnt; i++)
+			pages[i] = frames[i]->page;
+		anon_swap_out_cluster (pages, cnt, slot);
+		success = true;
+	} else
+		success = swap_out (page);
+
+	lock_acquire (&frame_lock);
+	vm_swap_cluster_end (frames, cnt);
+	if (success) {
+		vm_stat_add (victim->owner, evictions, 1);
+		vm_rss_add (victim->owner, victim, -1);
+		page_cache_unlink (victim);
+		swap_cache_remove (victim);
+		page->frame = NULL;
+		victim->page = NULL;
+		victim->owner = thread_current ();
+		victim->ref_cnt = 1;
+	} else
+		victim->pinned = false;
+	vm_frame_io_end (victim);
+	return success;
 }
 
 /* Evict one page and return the corresponding frame.
  * Return NULL on error.*/
 static struct frame *
 vm_evict_frame (void) {
-	struct frame *victim UNUSED = vm_get_victim ();
+	lock_acquire (&frame_lock);
+	struct frame *victim = vm_get_victim ();
 	/* TODO: swap out the victim and return the evicted frame. */
+	if (victim != NULL && victim->page == NULL) {
+		/* === project3 - Page Cache === */
+		vm_evict_text (victim);
+		page_cache_unlink (victim);
+		victim->owner = thread_current ();
+		victim->pinned = true;
+	} else if (victim != NULL && victim->ref_cnt > 1) {
+		/* === project3 - Copy On Write === */
+		if (vm_evict_shared (victim)) {
+			swap_cache_remove (victim);
+			victim->page = NULL;
+			victim->owner = thread_current ();
+			victim->pinned = true;
+			victim->ref_cnt = 1;
+		} else
+			victim = NULL;
+	} else if (victim != NULL && !vm_evict_page (victim))
+		victim = NULL;
+	lock_release (&frame_lock);
 
-	return NULL;
+	return victim;
+}
+
+/* === project3 - Pageout Daemon === */
+/* 빈 frame 수가 low 아래로 내려가면 vm_pageout 스레드를 깨우고,
+ * 스레드는 high에 닿을 때까지 미리 쫓아낸다. 그래서 fault를 처리하는
+ * 스레드는 대개 palloc에서 바로 frame을 얻고, swap I/O를 기다리지 않는다. */
+static size_t pageout_low;
+static size_t pageout_high;
+static struct semaphore pageout_sema;
+static bool pageout_requested;
+
+static void
+vm_pageout (void *aux UNUSED) {
+	for (;;) {
+		sema_down (&pageout_sema);
+		while (palloc_user_free_cnt () < pageout_high) {
+			struct frame *frame = vm_evict_frame ();
+			if (frame == NULL)
+				break;
+			lock_acquire (&frame_lock);
+			frame_put (frame, NULL);
+			lock_release (&frame_lock);
+		}
+		pageout_requested = false;
+	}
+}
+
+static void
+vm_pageout_init (void) {
+	pageout_low = palloc_user_free_cnt () / 32;
+	if (pageout_low < 4)
+		pageout_low = 4;
+	pageout_high = pageout_low * 2;
+	sema_init (&pageout_sema, 0);
+	pageout_requested = false;
+	thread_create ("vm_pageout", PRI_DEFAULT, vm_pageout, NULL);
+}
+
+/* 빈 frame이 low 아래이면 vm_pageout을 깨운다. */
+static void
+vm_pageout_wake (void) {
+	if (!pageout_requested && palloc_user_free_cnt () < pageout_low) {
+		pageout_requested = true;
+		sema_up (&pageout_sema);
+	}
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
  * and return it. This always return valid address. That is, if the user pool
  * memory is full, this function evicts the frame to get the available memory
  * space.*/
-static struct frame *
+/* 메모리와 swap이 모두 가득 차 내보낼 수 없으면 NULL을 반환한다.
+ * 반환된 frame은 pinned 상태이며, 호출자가 내용을 채운 뒤 풀어야 한다. */
+struct frame *
 vm_get_frame (void) {
 	struct frame *frame = NULL;
 	/* TODO: Fill this function. */
+	void *kva = palloc_get_page (PAL_USER);
+	vm_pageout_wake ();
+	if (kva == NULL)
+		frame = vm_evict_frame ();
+	else {
+		/* 방금 받은 frame은 page가 NULL이라 clock이 건드리지 않는다. */
+		frame = frame_lookup (kva);
+		frame->owner = thread_current ();
+		frame->pinned = true;
+		frame->ref_cnt = 1;
+	}
 
-	ASSERT (frame != NULL);
-	ASSERT (frame->page == NULL);
+	ASSERT (frame == NULL || frame->page == NULL);
 	return frame;
 }
 
+/* === project3 - Swap Readahead === */
+/* 한 번에 읽어 둘 페이지 수의 상한 */
+#define RA_WINDOW_MAX SWAP_READAHEAD_MAX
+
+/* 방금 swap에서 읽어 온 PAGE 바로 뒤의 가상 페이지들이 바로 다음
+ * 슬롯들에 swap 되어 있으면, window만큼 한 번에 읽어 둔다.
+ * 읽어 둔 페이지는 frame만 잡고 매핑하지 않으며, 접근하면
+ * vm_map_prefetched가 매핑한다. 빈 frame이 있을 때만 읽고,
+ * 이를 위해 다른 페이지를 쫓아내지는 않는다. */
+static void
+vm_swap_readahead (struct page *page) {
+	struct thread *curr = thread_current ();
+	struct supplemental_page_table *spt = &curr->spt;
+	struct page *pages[RA_WINDOW_MAX];
+	struct frame *frames[RA_WINDOW_MAX];
+	void *kvas[RA_WINDOW_MAX];
+	size_t slot = page->anon.swap_slot;
+	size_t cnt = 0;
+
+	/* 순차 접근이 보이면 꺼져 있던 readahead를 다시 켠다. */
+	if (spt->ra_window == 0
+			&& page->va == (uint8_t *) spt->ra_last + PGSIZE)
+		spt->ra_window = 1;
+	spt->ra_last = page->va;
+
+	/* MADV_SEQUENTIAL이면 window를 키워 가지 않고 처음부터 끝까지 읽는다. */
+	size_t window = page->advice == MADV_SEQUENTIAL
+		? RA_WINDOW_MAX : spt->ra_window;
+	while (cnt < window) {
+		struct page *next = spt_find_page (spt,
+				(uint8_t *) page->va + (cnt + 1) * PGSIZE);
+		if (next == NULL || VM_TYPE (next->operations->type) != VM_ANON
+				|| next->frame != NULL
+				|| next->anon.swap_slot != slot + cnt + 1)
+			break;
+
+		void *kva = palloc_get_page (PAL_USER);
+		if (kva == NULL)
+			break;
+		frames[cnt] = frame_lookup (kva);
+		frames[cnt]->owner = curr;
+		frames[cnt]->pinned = true;
+		frames[cnt]->ref_cnt = 1;
+		pages[cnt] = next;
+		kvas[cnt] = kva;
+		cnt++;
+	}
+	if (cnt == 0)
+		return;
+
+	anon_read_slots (slot + 1, cnt, kvas);
+	vm_stat_add (curr, readahead_pages, cnt);
+
+	lock_acquire (&frame_lock);
+	for (size_t i = 0; i < cnt; i++) {
+		vm_rss_add (curr, frames[i], 1);
+		pages[i]->frame = frames[i];
+		pages[i]->anon.prefetched = true;
+		frames[i]->page = pages[i];
+		/* 쫓겨나기 전 PTE에 남은 비트를 지워 두어야 불필요하게 다시
+		 * 쓰지 않고, 쓰이지 않은 페이지가 먼저 쫓겨난다. */
+		pml4_set_dirty (curr->pml4, pages[i]->va, false);
+		pml4_set_accessed (curr->pml4, pages[i]->va, false);
+		frames[i]->pinned = false;
+	}
+	lock_release (&frame_lock);
+}
+
+/* 읽어 둔 PAGE에 처음 접근했다. 매핑하고 window를 키운다.
+ * 쫓겨나는 중이면 끝나기를 기다리고, 쫓겨났다면 보통 fault처럼
+ * 처리한다. */
+static bool
+vm_map_prefetched (struct page *page) {
+	struct thread *curr = thread_current ();
+	struct supplemental_page_table *spt = &curr->spt;
+
+	lock_acquire (&frame_lock);
+	struct frame *frame = vm_page_frame (page);
+	if (frame == NULL) {
+		lock_release (&frame_lock);
+		return vm_do_claim_page (page);
+	}
+
+	if (page_get_type (page) == VM_ANON && page->anon.prefetched) {
+		page->anon.prefetched = false;
+		vm_stat_add (curr, readahead_hits, 1);
+		spt->ra_window = spt->ra_window == 0 ? 1 : spt->ra_window * 2;
+		if (spt->ra_window > RA_WINDOW_MAX)
+			spt->ra_window = RA_WINDOW_MAX;
+		spt->ra_last = page->va;
+	}
+
+	/* fork로 공유 중이면 읽기 전용으로 매핑해야 한다. 내보내지 못해
+	 * 매핑만 끊긴 frame이면 PTE에 남은 dirty 비트를 새 매핑에도 남긴다. */
+	bool writable = page->writable && frame->ref_cnt == 1;
+	bool dirty = pml4_is_dirty (curr->pml4, page->va);
+	if (writable)
+		swap_cache_remove (frame);
+	bool success = pml4_set_page (curr->pml4, page->va, frame->kva, writable);
+	if (success && dirty)
+		pml4_set_dirty (curr->pml4, page->va, true);
+	lock_release (&frame_lock);
+	return success;
+}
+
+/* 읽어 둔 채 쓰이지 않은 FRAME이 쫓겨난다. 주인의 window를 줄인다.
+ * frame_lock을 잡은 상태에서 호출해야 한다. */
+static void
+vm_readahead_miss (struct frame *frame) {
+	struct page *page = frame->page;
+
+	if (page_get_type (page) == VM_ANON && page->anon.prefetched) {
+		page->anon.prefetched = false;
+		frame->owner->spt.ra_window /= 2;
+	}
+}
+
+/* === project3 - Fault Around === */
+size_t vm_fault_around = 4;
+
+/* 이웃 페이지들을 한 번의 file_read_at으로 읽어 오는 버퍼 */
+static uint8_t *fault_around_buf;
+static struct lock fault_around_lock;
+
+static void
+fault_around_init (void) {
+	fault_around_buf = palloc_get_multiple (PAL_ASSERT, FAULT_AROUND_MAX);
+	lock_init (&fault_around_lock);
+}
+
+/* fault 난 페이지가 파일의 어디를 읽었는지. 이어지는 페이지를 찾는 데 쓴다. */
+struct fault_around_hint {
+	struct inode *inode;    /* 읽은 파일, NULL이면 fault-around 하지 않음 */
+	off_t next_ofs;         /* 바로 다음 페이지가 읽어야 할 오프셋 */
+	size_t window;          /* 함께 채울 최대 페이지 수 */
+};
+
+/* PAGE에서 fault가 났을 때 함께 채울 페이지 수.
+ * PAGE의 madvise 힌트에 따라 정한다. */
+static size_t
+vm_fault_around_window (struct page *page) {
+	if (page->advice == MADV_SEQUENTIAL)
+		return FAULT_AROUND_MAX;
+	if (page->advice == MADV_RANDOM)
+		return 0;
+	return vm_fault_around;
+}
+
+/* 아직 초기화되지 않은 PAGE가 파일을 끝까지 한 페이지 가득 읽는다면
+ * HINT에 다음 페이지의 위치와 함께 채울 페이지 수 WINDOW를 기록한다. */
+static void
+vm_fault_around_hint (struct page *page, size_t window,
+		struct fault_around_hint *hint) {
+	hint->inode = NULL;
+	hint->window = window;
+	if (hint->window == 0
+			|| VM_TYPE (page->operations->type) != VM_UNINIT
+			|| page->uninit.aux == NULL)
+		return;
+
+	struct lazy_load_arg *arg = page->uninit.aux;
+	if (arg->read_bytes == PGSIZE) {
+		hint->inode = file_get_inode (arg->file);
+		hint->next_ofs = arg->ofs + PGSIZE;
+	}
+}
+
+/* PAGE 뒤로 이어지는 페이지 중 아직 초기화되지 않았고 같은 파일의
+ * 연속된 구간을 읽는 페이지를 HINT의 window개까지 모아, 한 번의
+ * file_read_at으로 읽고 바로 매핑한다. 실행 파일 세그먼트와 mmap
+ * 페이지 모두 aux가 lazy_load_arg이므로 같은 방식으로 채울 수 있다.
+ * 빈 frame이 있을 때만 채우고, 이를 위해 쫓아내지는 않는다. */
+static void
+vm_fault_around_populate (struct page *page,
+		const struct fault_around_hint *hint) {
+	struct thread *curr = thread_current ();
+	struct page *pages[FAULT_AROUND_MAX];
+	struct frame *frames[FAULT_AROUND_MAX];
+	struct file *file = NULL;
+	size_t read_bytes = 0;
+	size_t cnt = 0;
+
+	while (cnt < hint->window) {
+		struct page *next = spt_find_page (&curr->spt,
+				(uint8_t *) page->va + (cnt + 1) * PGSIZE);
+		if (next == NULL || VM_TYPE (next->operations->type) != VM_UNINIT
+				|| next->uninit.aux == NULL)
+			break;
+
+		struct lazy_load_arg *arg = next->uninit.aux;
+		if (file_get_inode (arg->file) != hint->inode
+				|| arg->ofs != hint->next_ofs + (off_t) (cnt * PGSIZE)
+				|| arg->read_bytes == 0)
+			break;
+
+		void *kva = palloc_get_page (PAL_USER);
+		if (kva == NULL)
+			break;
+		frames[cnt] = frame_lookup (kva);
+		frames[cnt]->owner = curr;
+		frames[cnt]->pinned = true;
+		frames[cnt]->ref_cnt = 1;
+		pages[cnt++] = next;
+
+		if (file == NULL)
+			file = arg->file;
+		read_bytes += arg->read_bytes;
+		/* 끝이 잘린 페이지 뒤로는 파일 내용이 이어지지 않는다. */
+		if (arg->read_bytes < PGSIZE)
+			break;
+	}
+	if (cnt == 0)
+		return;
+
+	/* 파일 매핑 페이지는 채운 frame을 그대로 페이지 캐시에 올리므로
+	 * 캐시를 거치지 않고 읽는다. 실행 파일 페이지는 캐시를 거쳐 읽어
+	 * 다음 실행이 디스크를 읽지 않게 한다. */
+	bool mapped_file = VM_TYPE (pages[0]->uninit.type) == VM_FILE;
+	unsigned long seq = page_cache_seq ();
+	off_t bytes;
+
+	lock_acquire (&fault_around_lock);
+	if (mapped_file)
+		bytes = inode_read_disk (hint->inode, fault_around_buf, read_bytes,
+				hint->next_ofs);
+	else
+		bytes = file_read_at (file, fault_around_buf, read_bytes,
+				hint->next_ofs);
+	bool success = bytes == (off_t) read_bytes;
+	for (size_t i = 0; i < cnt && success; i++) {
+		struct lazy_load_arg *arg = pages[i]->uninit.aux;
+		memcpy (frames[i]->kva, fault_around_buf + i * PGSIZE, arg->read_bytes);
+		memset ((uint8_t *) frames[i]->kva + arg->read_bytes, 0,
+				arg->zero_bytes);
+		if (VM_TYPE (pages[i]->uninit.type) == VM_FILE)
+			page_cache_adopt (frames[i], hint->inode, arg->ofs,
+					arg->read_bytes, seq);
+	}
+	lock_release (&fault_around_lock);
+
+	for (size_t i = 0; i < cnt; i++) {
+		struct page *next = pages[i];
+		struct lazy_load_arg *arg = next->uninit.aux;
+
+		if (!success) {
+			lock_acquire (&frame_lock);
+			frame_put (frames[i], NULL);
+			lock_release (&frame_lock);
+			continue;
+		}
+
+		/* 내용은 이미 채웠으므로 initializer에는 KVA를 넘기지 않는다.
+		 * 파일 페이지는 lazy_load_file과 같이 arg의 파일을 넘겨받는다. */
+		next->uninit.page_initializer (next, next->uninit.type, NULL);
+		if (page_get_type (next) == VM_FILE) {
+			next->file.file = arg->file;
+			next->file.ofs = arg->ofs;
+			next->file.read_bytes = arg->read_bytes;
+			next->file.zero_bytes = arg->zero_bytes;
+		}
+		free (arg);
+
+		/* 매핑에 실패해도 frame은 붙여 둔다. 접근하면
+		 * vm_map_prefetched가 다시 매핑한다. */
+		lock_acquire (&frame_lock);
+		vm_stat_add (curr, fault_around_pages, 1);
+		vm_rss_add (curr, frames[i], 1);
+		next->frame = frames[i];
+		frames[i]->page = next;
+		if (pml4_set_page (curr->pml4, next->va, frames[i]->kva,
+					next->writable))
+			pml4_set_accessed (curr->pml4, next->va, false);
+		frames[i]->pinned = false;
+		lock_release (&frame_lock);
+	}
+}
+
+/* === project3 - Shared Text === */
+/* 아직 접근하지 않은 PAGE가 실행 파일의 읽기 전용 세그먼트 페이지라면
+ * 같은 실행 파일을 돌리는 프로세스들과 페이지 캐시의 frame 하나를
+ * 읽기 전용으로 함께 매핑한다. 매핑한 뒤의 PAGE는 fork로 frame을
+ * 공유 중인 익명 페이지와 같다. 쓰기 권한이 없으므로 COW는 일어나지 않고,
+ * clock은 매핑을 모두 끊고 frame을 캐시로 돌려보낸다.
+ * 함께 쓸 수 없는 페이지면 아무것도 바꾸지 않고 false를 반환한다. */
+static bool
+vm_map_shared_text (struct page *page) {
+	struct thread *curr = thread_current ();
+
+	if (page->writable || VM_TYPE (page->operations->type) != VM_UNINIT
+			|| VM_TYPE (page->uninit.type) != VM_ANON
+			|| page->uninit.aux == NULL)
+		return false;
+
+	struct lazy_load_arg *arg = page->uninit.aux;
+	if (arg->read_bytes == 0)
+		return false;
+
+	if (!page_cache_share (file_get_inode (arg->file), arg->ofs,
+				arg->read_bytes, page))
+		return false;
+
+	/* PAGE가 VM_UNINIT인 동안은 clock이 frame을 내보내지 않으므로,
+	 * 익명 페이지로 바꾸고 매핑하는 것까지 락을 잡은 채 끝낸다. */
+	lock_acquire (&frame_lock);
+	struct frame *frame = page->frame;
+	anon_initializer (page, page->uninit.type, NULL);
+	vm_rss_add (curr, frame, 1);
+	/* 매핑에 실패해도 frame은 붙여 둔다. 다시 접근하면
+	 * vm_map_prefetched가 읽기 전용으로 매핑한다. */
+	pml4_set_page (curr->pml4, page->va, frame->kva, false);
+	lock_release (&frame_lock);
+	free (arg);
+	return true;
+}
+
+/* clock이 vm_evict_text로 매핑을 끊은 PAGE인지 확인한다. 그런 페이지는
+ * frame도 swap 사본도 없는 읽기 전용 세그먼트의 익명 페이지이다. */
+static bool
+vm_text_evicted (struct page *page) {
+	return VM_TYPE (page->operations->type) == VM_ANON
+		&& page->frame == NULL && !page->writable
+		&& page->seg_init != NULL && page->seg_read_bytes > 0
+		&& page->anon.swap_slot == SWAP_SLOT_NONE
+		&& page->anon.zswap == NULL;
+}
+
+/* === project3 - Huge Pages === */
+bool vm_huge_pages = true;
+
+/* 2 MB로 정렬된 BASE의 구간은 SPT leaf 노드 하나와 겹치므로, leaf를
+ * 한 번 찾아 슬롯 512개를 차례로 본다. 모든 페이지가 아직 접근하지 않은,
+ * 0으로 채워질 쓰기 가능한 익명 페이지면 leaf를, 아니면 NULL을 반환한다. */
+static struct page **
+vm_huge_leaf (uint8_t *base) {
+	struct page **leaf = spt_walk (&thread_current ()->spt, base, false);
+
+	ASSERT (HPG_PAGES == SPT_FANOUT);
+	if (leaf == NULL)
+		return NULL;
+	for (size_t i = 0; i < HPG_PAGES; i++)
+		if (leaf[i] == NULL || !leaf[i]->writable
+				|| !vm_is_zero_fill (leaf[i]))
+			return NULL;
+	return leaf;
+}
+
+/* PAGE에 쓰기 fault가 났고 PAGE가 속한 2 MB 구간 전체가 아직 한 번도
+ * 접근되지 않은 익명 영역이면, 정렬된 연속 frame 512개로 모두 채우고
+ * PDE 하나로 매핑한다.
+ * PDE 하나의 dirty, accessed 비트는 구간 전체의 것이다. 익명 페이지는
+ * swap 사본이 없어 어차피 써야 하므로 dirty 비트가 거칠어도 되고,
+ * clock이 accessed 비트를 지울 때는 pml4가 매핑을 먼저 쪼갠다.
+ * 읽기만 하는 구간은 zero frame으로 충분하므로 쓰기 fault에서만 채운다.
+ * 구간의 페이지는 각자 frame을 가지므로, 하나가 쫓겨나거나
+ * munmap 되면 pml4가 매핑을 4 KB 페이지들로 쪼갠다.
+ * 빈 frame이 넉넉할 때만 시도하며, 매핑하지 못하면 false를 반환한다.
+ * 이때 채워 둔 페이지는 vm_map_prefetched가 4 KB로 매핑한다. */
+static bool
+vm_huge_fault (struct page *page, bool write) {
+	struct thread *curr = thread_current ();
+	uint8_t *base = hpg_round_down (page->va);
+	struct page **leaf;
+
+	if (!vm_huge_pages || !write
+			|| palloc_user_free_cnt () < HPG_PAGES + pageout_high
+			|| (leaf = vm_huge_leaf (base)) == NULL)
+		return false;
+
+	uint8_t *kva = palloc_get_aligned (PAL_USER, HPG_PAGES, HPG_PAGES);
+	if (kva == NULL)
+		return false;
+	vm_pageout_wake ();
+
+	size_t cnt;
+	for (cnt = 0; cnt < HPG_PAGES; cnt++) {
+		struct frame *frame = frame_lookup (kva + cnt * PGSIZE);
+		struct page *p = leaf[cnt];
+
+		frame->owner = curr;
+		frame->pinned = true;
+		frame->ref_cnt = 1;
+		frame->page = p;
+		p->frame = frame;
+		vm_rss_add (curr, frame, 1);
+		if (!swap_in (p, frame->kva))
+			break;
+	}
+
+	bool mapped = false;
+	lock_acquire (&frame_lock);
+	if (cnt == HPG_PAGES)
+		mapped = pml4_set_huge_page (curr->pml4, base, kva, page->writable);
+	if (mapped)
+		vm_stat_add (curr, huge_maps, 1);
+	for (size_t i = 0; i < HPG_PAGES; i++) {
+		struct frame *frame = frame_lookup (kva + i * PGSIZE);
+
+		if (i < cnt)
+			frame->pinned = false;
+		else if (i == cnt) {
+			/* 초기화에 실패한 페이지는 보통 fault처럼 다시 시도한다. */
+			frame->page->frame = NULL;
+			vm_rss_add (curr, frame, -1);
+			frame_put (frame, NULL);
+		} else
+			palloc_free_page (frame->kva);
+	}
+	lock_release (&frame_lock);
+	return mapped;
+}
+
+/* === project3 - Stack Growth === */
+/* ADDR이 스택을 키워서 처리할 수 있는 접근인지 확인한다.
+ * push 명령은 rsp보다 8바이트 아래를 먼저 건드릴 수 있다. */
+static bool
+vm_is_stack_access (void *addr, void *rsp) {
+	return (uint8_t *) addr >= (uint8_t *) rsp - 8
+		&& addr < (void *) USER_STACK
+		&& addr >= (void *) (USER_STACK - STACK_LIMIT);
+}
+
 /* Growing the stack. */
 static void
-vm_stack_growth (void *addr UNUSED) {
+vm_stack_growth (void *addr) {
+	if (vm_alloc_page (VM_ANON | VM_STACK, pg_round_down (addr), true))
+		vm_stat_add (thread_current (), stack_growths, 1);
 }
 
 /* Handle the fault on write_protected page */
+/* === project3 - Copy On Write ===
+ * 공유 중인 frame에 처음 쓰려고 할 때 불린다. 마지막 남은 매핑이면
+ * 쓰기 권한만 돌려주고, 아니면 새 frame에 복사한 뒤 갈아탄다. */
 static bool
-vm_handle_wp (struct page *page UNUSED) {
+vm_handle_wp (struct page *page) {
+	uint64_t *pml4 = thread_current ()->pml4;
+
+	/* ksmd가 PAGE를 다른 frame으로 옮겼을 수 있으므로 락을 잡고 읽는다. */
+	lock_acquire (&frame_lock);
+	struct frame *frame = vm_page_frame (page);
+	if (frame == NULL) {
+		/* fault가 난 뒤 내보내졌다. 다시 접근하면 읽어 온다. */
+		lock_release (&frame_lock);
+		return true;
+	}
+	if (frame->ref_cnt == 1) {
+		frame->page = page;
+		frame->owner = thread_current ();
+		swap_cache_remove (frame);
+		pml4_set_writable (pml4, page->va, true);
+		lock_release (&frame_lock);
+		return true;
+	}
+	lock_release (&frame_lock);
+
+	/* 복사하는 동안 frame은 eviction이나 ksmd로 PAGE에서 떨어질 수 있다.
+	 * 그러면 복사본을 버리고, 다시 나는 fault가 PAGE를 새로 읽어 온다. */
+	struct frame *copy = vm_get_frame ();
+	if (copy == NULL)
+		return false;
+	if (frame == &zero_frame)
+		memset (copy->kva, 0, PGSIZE);
+	else
+		memcpy (copy->kva, frame->kva, PGSIZE);
+
+	lock_acquire (&frame_lock);
+	if (vm_page_frame (page) != frame) {
+		frame_put (copy, NULL);
+		lock_release (&frame_lock);
+		return true;
+	}
+	frame_put (frame, page);
+	lock_release (&frame_lock);
+
+	vm_stat_add (thread_current (), cow_copies, 1);
+	vm_rss_add (thread_current (), frame, -1);
+	vm_rss_add (thread_current (), copy, 1);
+	copy->page = page;
+	page->frame = copy;
+	if (!pml4_set_page (pml4, page->va, copy->kva, true)) {
+		vm_free_frame (page);
+		return false;
+	}
+	copy->pinned = false;
+	return true;
 }
 
 /* Return true on success */
 bool
-vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
-		bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
-	struct supplemental_page_table *spt UNUSED = &thread_current ()->spt;
+vm_try_handle_fault (struct intr_frame *f, void *addr,
+		bool user, bool write, bool not_present) {
+	struct thread *curr = thread_current ();
+	struct supplemental_page_table *spt = &curr->spt;
 	struct page *page = NULL;
 	/* TODO: Validate the fault */
 	/* TODO: Your code goes here */
+	if (addr == NULL || is_kernel_vaddr (addr))
+		return false;
 
-	return vm_do_claim_page (page);
+	page = spt_find_page (spt, addr);
+
+	/* 이미 매핑된 페이지에 대한 권한 위반 */
+	if (!not_present) {
+		if (page == NULL || !write || !page->writable)
+			return false;
+		vm_stat_fault (curr, page);
+		return vm_handle_wp (page);
+	}
+
+	if (page == NULL) {
+		/* 커널 모드에서 난 fault면 syscall 진입 때 저장한 사용자 rsp를 쓴다. */
+		void *rsp = user ? (void *) f->rsp : curr->user_rsp;
+		if (!vm_is_stack_access (addr, rsp))
+			return false;
+		vm_stack_growth (addr);
+		page = spt_find_page (spt, addr);
+		if (page == NULL)
+			return false;
+	}
+
+	if (write && !page->writable)
+		return false;
+
+	vm_stat_fault (curr, page);
+	/* 매핑을 잃은 실행 파일 페이지는 처음 상태로 되돌려 다시 함께 쓴다. */
+	if (vm_text_evicted (page))
+		vm_anon_reset (page);
+	if (vm_map_shared_text (page))
+		return true;
+	if (vm_huge_fault (page, write))
+		return true;
+
+	if (!write && vm_is_zero_fill (page))
+		return vm_map_zero_page (page);
+
+	/* readahead로 읽어 둔 페이지는 매핑만 하면 된다. */
+	if (page->frame != NULL)
+		return vm_map_prefetched (page);
+
+	struct fault_around_hint hint;
+	bool swapped = VM_TYPE (page->operations->type) == VM_ANON
+		&& page->anon.swap_slot != SWAP_SLOT_NONE;
+	vm_fault_around_hint (page, vm_fault_around_window (page), &hint);
+	if (!vm_do_claim_page (page))
+		return false;
+	if (swapped && page->advice != MADV_RANDOM)
+		vm_swap_readahead (page);
+	else if (hint.inode != NULL)
+		vm_fault_around_populate (page, &hint);
+	if (page->advice == MADV_SEQUENTIAL)
+		vm_evict_behind (page);
+	return true;
 }
 
 /* Free the page.
@@ -150,9 +1617,12 @@ vm_dealloc_page (struct page *page) {
 
 /* Claim the page that allocate on VA. */
 bool
-vm_claim_page (void *va UNUSED) {
+vm_claim_page (void *va) {
 	struct page *page = NULL;
 	/* TODO: Fill this function */
+	page = spt_find_page (&thread_current ()->spt, va);
+	if (page == NULL)
+		return false;
 
 	return vm_do_claim_page (page);
 }
@@ -160,31 +1630,550 @@ vm_claim_page (void *va UNUSED) {
 /* Claim the PAGE and set up the mmu. */
 static bool
 vm_do_claim_page (struct page *page) {
+	/* === project3 - Shared Text === */
+	if (vm_text_evicted (page) && !vm_anon_reset (page))
+		return false;
+	/* === project3 - Copy On Write === */
+	if (vm_map_swap_cached (page))
+		return true;
+
 	struct frame *frame = vm_get_frame ();
+	if (frame == NULL)
+		return false;
 
 	/* Set links */
 	frame->page = page;
 	page->frame = frame;
+	vm_rss_add (thread_current (), frame, 1);
 
 	/* TODO: Insert page table entry to map page's VA to frame's PA. */
+	if (!pml4_set_page (thread_current ()->pml4, page->va, frame->kva,
+				page->writable)) {
+		vm_free_frame (page);
+		return false;
+	}
+
+	bool success = swap_in (page, frame->kva);
+	if (success)
+		vm_swap_cache_add (page);
+	frame->pinned = false;
+	return success;
+}
+
+/* === project3 - Copy On Write === */
+/* PAGE가 FRAME을 함께 매핑한다. zero frame이 아니면 PAGE를 sharers에
+ * 넣어 두어, 대표가 떠나거나 frame을 내보낼 때 찾을 수 있게 한다.
+ * 실행 파일 페이지로 매핑된 캐시 frame은 대표 없이 모든 매핑이
+ * sharers에 있다. frame_lock을 잡은 상태여야 한다. */
+void
+frame_share (struct frame *frame, struct page *page) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	frame->ref_cnt++;
+	if (frame != &zero_frame)
+		list_push_back (&frame->sharers, &page->share_elem);
+}
+
+/* === project3 - Memory Management === */
+/* FRAME에서 PAGE의 참조를 하나 뗀다. 마지막 참조였다면 frame을
+ * user pool에 돌려준다. frame_lock을 잡은 상태여야 한다. */
+void
+frame_put (struct frame *frame, struct page *page) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	if (--frame->ref_cnt == 0) {
+		ASSERT (list_empty (&frame->sharers));
+		page_cache_unlink (frame);
+		swap_cache_remove (frame);
+		frame->page = NULL;
+		frame->owner = NULL;
+		frame->pinned = false;
+		if (thread_current ()->spt.unmapping)
+			free_batch_add (frame->kva);
+		else
+			palloc_free_page (frame->kva);
+	} else if (frame->page == page) {
+		/* 대표 매핑이 떠났다. 남은 매핑 중 하나가 대표가 되어
+		 * clock이 계속 이 frame을 볼 수 있게 한다. */
+		if (!list_empty (&frame->sharers)) {
+			struct page *next = list_entry (list_pop_front (&frame->sharers),
+					struct page, share_elem);
+			frame->page = next;
+			frame->owner = next->owner;
+		} else {
+			frame->page = NULL;
+			frame->owner = NULL;
+		}
+	} else if (page != NULL && frame != &zero_frame)
+		list_remove (&page->share_elem);
+}
+
+/* PAGE에 연결된 frame의 매핑을 지우고 frame을 반환한다.
+ * PAGE는 현재 스레드의 페이지여야 한다. */
+void
+vm_free_frame (struct page *page) {
+	struct thread *curr = thread_current ();
+	uint64_t *pml4 = curr->pml4;
+
+	lock_acquire (&frame_lock);
+	struct frame *frame = vm_page_frame (page);
+	if (frame != NULL) {
+		/* vm_unmap_begin이 이미 매핑을 지워 두었다. */
+		if (pml4 != NULL && !curr->spt.unmapping)
+			pml4_clear_page (pml4, page->va);
+		vm_rss_add (curr, frame, -1);
+		page->frame = NULL;
+		frame_put (frame, page);
+	}
+	lock_release (&frame_lock);
+}
+
+/* === project3 - Batched Unmap === */
+/* 해제를 미뤄 둔 frame. 가득 차거나 vm_unmap_end에서 한꺼번에
+ * palloc에 돌려준다. frame_lock이 보호한다. */
+#define FREE_BATCH_MAX 64
+static void *free_batch[FREE_BATCH_MAX];
+static size_t free_batch_cnt;
+
+static void
+free_batch_flush (void) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	palloc_free_pages (free_batch, free_batch_cnt);
+	free_batch_cnt = 0;
+}
+
+static void
+free_batch_add (void *kva) {
+	if (free_batch_cnt == FREE_BATCH_MAX)
+		free_batch_flush ();
+	free_batch[free_batch_cnt++] = kva;
+}
+
+/* [START, END)의 페이지를 여러 개 해제하기 전에 부른다. 매핑을
+ * 한 번에 지우고 TLB도 한 번만 비우며, 이어지는 페이지 해제가
+ * 돌려주는 frame은 모아 두었다가 vm_unmap_end에서 한꺼번에 푼다.
+ * 매핑을 지워도 dirty 비트는 남으므로 write back은 그대로 된다. */
+void
+vm_unmap_begin (void *start, void *end) {
+	struct thread *curr = thread_current ();
+
+	ASSERT (!curr->spt.unmapping);
+	if (curr->pml4 != NULL)
+		pml4_clear_range (curr->pml4, start, end);
+	curr->spt.unmapping = true;
+}
+
+void
+vm_unmap_end (void) {
+	thread_current ()->spt.unmapping = false;
+	lock_acquire (&frame_lock);
+	free_batch_flush ();
+	lock_release (&frame_lock);
+}
+
+/* === project3 - madvise === */
+/* MADV_SEQUENTIAL 구간에서 PAGE까지 읽었으면, 그보다 SEQ_BEHIND 페이지
+ * 이상 뒤에 있는 페이지는 다시 쓰이지 않을 가능성이 높다. accessed 비트를
+ * 지워 두면 clock이 다른 페이지보다 먼저 내보낸다. fault 사이 간격은
+ * fault-around window를 넘지 않으므로 그만큼씩 지우면 빠짐없이 지나간다. */
+#define SEQ_BEHIND FAULT_AROUND_MAX
+
+static void
+vm_evict_behind (struct page *page) {
+	struct thread *curr = thread_current ();
+	uint8_t *va = page->va;
+
+	if ((uint64_t) va < 2 * SEQ_BEHIND * PGSIZE)
+		return;
+
+	lock_acquire (&frame_lock);
+	for (size_t i = SEQ_BEHIND; i < 2 * SEQ_BEHIND; i++) {
+		struct page *p = spt_find_page (&curr->spt, va - (i + 1) * PGSIZE);
+		if (p == NULL || p->advice != MADV_SEQUENTIAL)
+			break;
+		if (p->frame != NULL && p->frame->page == p)
+			pml4_set_accessed (curr->pml4, p->va, false);
+	}
+	lock_release (&frame_lock);
+}
+
+/* MADV_WILLNEED: 아직 메모리에 없고 디스크에서 읽어야 하는 PAGE를
+ * 미리 읽어 매핑해 둔다. 0으로 채울 페이지는 읽을 것이 없으므로 건너뛴다.
+ * 빈 frame이 넉넉할 때만 읽고, 이를 위해 쫓아내지는 않는다.
+ * 더 읽을 수 없으면 false를 반환해 순회를 멈춘다. */
+static bool
+madvise_willneed (struct page *page, void *aux UNUSED) {
+	struct thread *curr = thread_current ();
+	enum vm_type type = VM_TYPE (page->operations->type);
+
+	if (page->frame != NULL || vm_is_zero_fill (page)
+			|| (type == VM_ANON && page->anon.swap_slot == SWAP_SLOT_NONE
+				&& page->anon.zswap == NULL))
+		return true;
+	if (palloc_user_free_cnt () < pageout_high)
+		return false;
+
+	void *kva = palloc_get_page (PAL_USER);
+	if (kva == NULL)
+		return false;
+	vm_pageout_wake ();
+
+	struct frame *frame = frame_lookup (kva);
+	frame->owner = curr;
+	frame->pinned = true;
+	frame->ref_cnt = 1;
+	frame->page = page;
+	page->frame = frame;
+	vm_rss_add (curr, frame, 1);
+	bool success = swap_in (page, kva);
+
+	lock_acquire (&frame_lock);
+	if (!success) {
+		page->frame = NULL;
+		vm_rss_add (curr, frame, -1);
+		frame_put (frame, NULL);
+	} else {
+		vm_stat_add (curr, readahead_pages, 1);
+		/* 매핑에 실패해도 frame은 붙여 둔다. 접근하면
+		 * vm_map_prefetched가 다시 매핑한다. */
+		if (pml4_set_page (curr->pml4, page->va, kva, page->writable))
+			pml4_set_accessed (curr->pml4, page->va, false);
+		frame->pinned = false;
+	}
+	lock_release (&frame_lock);
+	return success;
+}
+
+/* 익명 PAGE의 frame과 swap 사본을 모두 놓고 처음 상태로 되돌린다.
+ * 실행 파일 세그먼트의 페이지는 run_file의 원래 위치에서 다시 읽고,
+ * 나머지는 0으로 채운다. 메모리가 부족하면 아무것도 바꾸지 않고
+ * false를 반환한다. */
+static bool
+vm_anon_reset (struct page *page) {
+	struct page saved = *page;
+	struct lazy_load_arg *arg = NULL;
+
+	if (saved.seg_init != NULL && saved.seg_read_bytes > 0) {
+		arg = malloc (sizeof *arg);
+		if (arg == NULL)
+			return false;
+		arg->file = thread_current ()->run_file;
+		arg->ofs = saved.seg_ofs;
+		arg->read_bytes = saved.seg_read_bytes;
+		arg->zero_bytes = PGSIZE - saved.seg_read_bytes;
+	}
+
+	destroy (page);
+	uninit_new (page, page->va, arg != NULL ? saved.seg_init : NULL,
+			VM_ANON, arg, anon_initializer);
+	page->writable = saved.writable;
+	page->mmap_cnt = saved.mmap_cnt;
+	page->advice = saved.advice;
+	page->owner = saved.owner;
+	page->seg_init = saved.seg_init;
+	page->seg_ofs = saved.seg_ofs;
+	page->seg_read_bytes = saved.seg_read_bytes;
+	return true;
+}
+
+/* MADV_DONTNEED: PAGE의 내용을 버린다. 파일 페이지는 write back 후
+ * frame만 놓아 다음 접근 때 파일에서 다시 읽고, 익명 페이지는
+ * vm_anon_reset으로 처음 상태로 되돌린다. 메모리가 부족하면 그 페이지는
+ * 그대로 둔다. */
+static bool
+madvise_dontneed (struct page *page, void *aux UNUSED) {
+	switch (VM_TYPE (page->operations->type)) {
+		case VM_FILE:
+			file_backed_drop (page);
+			break;
+		case VM_ANON:
+			vm_anon_reset (page);
+			break;
+		default:
+			break;
+	}
+	return true;
+}
+
+static bool
+madvise_set (struct page *page, void *advice) {
+	page->advice = *(int *) advice;
+	return true;
+}
+
+/* [ADDR, ADDR + LENGTH)에 ADVICE를 적용한다. 구간 안의 빈 주소는
+ * 건너뛴다. ADVICE를 알 수 없으면 false를 반환한다. */
+bool
+vm_madvise (void *addr, size_t length, int advice) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	void *end = (uint8_t *) addr + ROUND_UP (length, PGSIZE);
+
+	switch (advice) {
+		case MADV_NORMAL:
+		case MADV_RANDOM:
+		case MADV_SEQUENTIAL:
+			spt_for_each (spt, addr, end, madvise_set, &advice);
+			return true;
+		case MADV_WILLNEED:
+			spt_for_each (spt, addr, end, madvise_willneed, NULL);
+			return true;
+		case MADV_DONTNEED:
+			vm_unmap_begin (addr, end);
+			spt_for_each (spt, addr, end, madvise_dontneed, NULL);
+			vm_unmap_end ();
+			return true;
+		default:
+			return false;
+	}
+}
+
+/* === project3 - Populate === */
+/* [START, END)의 페이지를 모두 미리 읽어 매핑한다. 파일에서 읽는
+ * 페이지는 fault-around처럼 이어지는 구간을 FAULT_AROUND_MAX개씩
+ * 한 번에 읽는다. 이미 frame이 있는 페이지는 매핑만 한다.
+ * 메모리가 부족하면 보통 fault처럼 다른 페이지를 쫓아낸다.
+ * frame을 얻지 못한 페이지가 있으면 false를 반환한다. */
+bool
+vm_populate (void *start, void *end) {
+	struct thread *curr = thread_current ();
+
+	for (uint8_t *va = start; va < (uint8_t *) end; va += PGSIZE) {
+		struct page *page = spt_find_page (&curr->spt, va);
+		if (page == NULL)
+			continue;
+
+		/* zero page나 fork로 공유 중인 frame은 이미 매핑되어 있다.
+		 * 읽어 두기만 한 페이지는 매핑해 준다. */
+		if (page->frame != NULL) {
+			if (pml4_get_page (curr->pml4, va) == NULL
+					&& !vm_map_prefetched (page))
+				return false;
+			continue;
+		}
+
+		struct fault_around_hint hint;
+		vm_fault_around_hint (page, FAULT_AROUND_MAX, &hint);
+		if (!vm_do_claim_page (page))
+			return false;
+		if (hint.inode != NULL)
+			vm_fault_around_populate (page, &hint);
+	}
+	return true;
+}
+
+/* === project3 - Anonymous Memory === */
+/* spt_for_each 콜백: 힙 페이지를 제거한다. */
+static bool
+heap_remove_page (struct page *page, void *spt) {
+	spt_remove_page (spt, page);
+	return true;
+}
+
+/* 힙의 끝을 INCREMENT 바이트 옮기고 옮기기 전의 끝을 반환한다.
+ * 새로 덮는 페이지는 0으로 채워질 익명 페이지로 만들어 두고, 더 이상
+ * 덮지 않는 페이지는 제거한다. 다른 매핑이나 스택 영역과 겹치거나
+ * 힙 시작보다 아래로 내려가면 (void *) -1을 반환한다. */
+void *
+vm_sbrk (intptr_t increment) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *old_brk = spt->brk;
+	uint8_t *new_brk = old_brk + increment;
+	uint8_t *old_end = pg_round_up (old_brk);
+	uint8_t *new_end = pg_round_up (new_brk);
+
+	if (spt->heap_start == NULL)
+		return (void *) -1;
+	if (increment >= 0 ? new_brk < old_brk
+				|| new_brk > (uint8_t *) USER_STACK - STACK_LIMIT
+			: new_brk > old_brk || new_brk < (uint8_t *) spt->heap_start)
+		return (void *) -1;
+
+	for (uint8_t *va = old_end; va < new_end; va += PGSIZE)
+		if (!vm_alloc_page (VM_ANON, va, true)) {
+			/* 이미 만든 페이지를 되돌린다. */
+			spt_for_each (spt, old_end, va, heap_remove_page, spt);
+			return (void *) -1;
+		}
+	if (new_end < old_end) {
+		vm_unmap_begin (new_end, old_end);
+		spt_for_each (spt, new_end, old_end, heap_remove_page, spt);
+		vm_unmap_end ();
+	}
 
-	return swap_in (page, frame->kva);
+	spt->brk = new_brk;
+	return old_brk;
 }
 
 /* Initialize new supplemental page table */
 void
-supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
+supplemental_page_table_init (struct supplemental_page_table *spt) {
+	spt->root = NULL;
+	spt->hint_leaf = NULL;
+	spt->hint_key = 0;
+	spt->page_cnt = 0;
+	spt->ra_window = 0;
+	spt->ra_last = NULL;
+	spt->unmapping = false;
+	memset (&spt->stats, 0, sizeof spt->stats);
+	spt->heap_start = NULL;
+	spt->brk = NULL;
+}
+
+/* === project3 - Copy On Write === */
+/* 아직 한 번도 접근하지 않은 SRC 페이지를 자식에게 그대로 만들어 준다. */
+static bool
+spt_copy_uninit (struct page *src) {
+	struct uninit_page *uninit = &src->uninit;
+	struct lazy_load_arg *arg = NULL;
+
+	if (uninit->aux != NULL) {
+		arg = malloc (sizeof *arg);
+		if (arg == NULL)
+			return false;
+		*arg = *(struct lazy_load_arg *) uninit->aux;
+
+		/* mmap 페이지는 각자 파일을 닫으므로 따로 열고, 익명 페이지의
+		 * 파일은 실행 파일이므로 자식이 복제해 둔 run_file을 쓴다. */
+		if (VM_TYPE (uninit->type) == VM_FILE)
+			arg->file = file_reopen (arg->file);
+		else
+			arg->file = thread_current ()->run_file;
+		if (arg->file == NULL) {
+			free (arg);
+			return false;
+		}
+	}
+
+	if (!vm_alloc_page_with_initializer (uninit->type, src->va,
+				src->writable, uninit->init, arg)) {
+		if (arg != NULL && VM_TYPE (uninit->type) == VM_FILE)
+			file_close (arg->file);
+		free (arg);
+		return false;
+	}
+	struct page *page = spt_find_page (&thread_current ()->spt, src->va);
+	page->mmap_cnt = src->mmap_cnt;
+	page->advice = src->advice;
+	return true;
+}
+
+/* spt_for_each 콜백: SRC 페이지를 현재 스레드(자식)의 SPT로 복사한다.
+ * 메모리에 있는 익명 페이지는 frame을 읽기 전용으로 공유하고,
+ * 나머지는 자식 몫의 사본을 만든다. 파일 페이지는 munmap과 exit 때
+ * 각자 자기 파일에 write back 하므로 공유하지 않는다. */
+static bool
+spt_copy_page (struct page *src, void *dst) {
+	struct thread *curr = thread_current ();
+	enum vm_type type = page_get_type (src);
+
+	if (VM_TYPE (src->operations->type) == VM_UNINIT)
+		return spt_copy_uninit (src);
+
+	struct page *page = malloc (sizeof *page);
+	if (page == NULL)
+		return false;
+	*page = *src;
+	page->frame = NULL;
+	if (type == VM_FILE) {
+		page->file.file = file_reopen (src->file.file);
+		if (page->file.file == NULL) {
+			free (page);
+			return false;
+		}
+	} else {
+		page->anon.swap_slot = SWAP_SLOT_NONE;
+		page->anon.prefetched = false;
+		page->anon.zswap = NULL;
+	}
+
+	if (!spt_insert_page (dst, page)) {
+		if (type == VM_FILE)
+			file_close (page->file.file);
+		free (page);
+		return false;
+	}
+
+	lock_acquire (&frame_lock);
+	struct frame *frame = vm_page_frame (src);
+	if (frame != NULL && type == VM_ANON) {
+		/* 부모는 fork가 끝날 때까지 멈춰 있으므로 부모 PTE를 고쳐도 된다.
+		 * 이미 공유 중이던 frame은 모든 PTE가 읽기 전용이다. 대표 매핑은
+		 * 다른 프로세스의 다른 주소일 수 있으므로 부모의 PTE를 고친다.
+		 * 자식 매핑까지 락을 잡은 채 끝내야 그 사이 내보내지지 않는다. */
+		if (frame->ref_cnt == 1)
+			pml4_set_writable (src->owner->pml4, src->va, false);
+		frame_share (frame, page);
+		page->frame = frame;
+		vm_rss_add (curr, frame, 1);
+		bool success = pml4_set_page (curr->pml4, page->va, frame->kva, false);
+		lock_release (&frame_lock);
+		return success;
+	}
+	if (frame != NULL)
+		frame->pinned = true;
+	lock_release (&frame_lock);
+
+	/* 내보내진 파일 페이지는 파일에 최신 내용이 있으므로 나중에 읽는다.
+	 * 매핑을 잃은 실행 파일 페이지도 자식의 run_file에서 다시 읽는다. */
+	if (frame == NULL && (type == VM_FILE || vm_text_evicted (src)))
+		return true;
+	/* swap된 익명 페이지는 부모의 슬롯을 함께 가리킨다. 먼저 읽어 오는
+	 * 쪽의 frame을 다른 쪽은 swap 캐시에서 함께 매핑한다. */
+	if (frame == NULL && src->anon.zswap == NULL) {
+		anon_attach_slot (page, src->anon.swap_slot);
+		return true;
+	}
+
+	struct frame *copy = vm_get_frame ();
+	if (copy != NULL) {
+		if (frame != NULL)
+			memcpy (copy->kva, frame->kva, PGSIZE);
+		else
+			anon_read_slot (src, copy->kva);
+		copy->page = page;
+		page->frame = copy;
+		vm_rss_add (curr, copy, 1);
+	}
+	if (frame != NULL)
+		frame->pinned = false;
+	if (copy == NULL)
+		return false;
+
+	bool success = pml4_set_page (curr->pml4, page->va, copy->kva,
+			page->writable);
+	copy->pinned = false;
+	return success;
 }
 
 /* Copy supplemental page table from src to dst */
 bool
-supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
-		struct supplemental_page_table *src UNUSED) {
+supplemental_page_table_copy (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src) {
+	ASSERT (dst == &thread_current ()->spt);
+	dst->heap_start = src->heap_start;
+	dst->brk = src->brk;
+	return spt_for_each (src, NULL, (void *) KERN_BASE, spt_copy_page, dst);
+}
+
+/* spt_for_each 콜백: 페이지를 해제한다. */
+static bool
+spt_kill_page (struct page *page, void *aux UNUSED) {
+	vm_dealloc_page (page);
+	return true;
 }
 
 /* Free the resource hold by the supplemental page table */
 void
-supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
+supplemental_page_table_kill (struct supplemental_page_table *spt) {
 	/* TODO: Destroy all the supplemental_page_table hold by thread and
 	 * TODO: writeback all the modified contents to the storage. */
+	if (spt->root == NULL)
+		return;
+
+	vm_unmap_begin (NULL, (void *) KERN_BASE);
+	spt_for_each (spt, NULL, (void *) KERN_BASE, spt_kill_page, NULL);
+	vm_unmap_end ();
+	spt_node_destroy (spt->root, 0);
+	supplemental_page_table_init (spt);
 }
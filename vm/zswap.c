@@ -0,0 +1,394 @@
+/* zswap.c: Compressed in-memory cache in front of the swap disk. */
+
+#include "vm/zswap.h"
+#include <bitmap.h>
+#include <list.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/vm.h"
+
+/* === project3 - Compressed Swap Cache === */
+/* 압축된 페이지를 담는 arena의 크기(페이지)와 할당 단위(바이트) */
+#define ZSWAP_ARENA_PAGES 64
+#define ZSWAP_CHUNK 64
+#define ZSWAP_CHUNK_CNT (ZSWAP_ARENA_PAGES * PGSIZE / ZSWAP_CHUNK)
+
+/* 이보다 크게 압축되는 페이지는 캐시하지 않고 바로 디스크에 쓴다. */
+#define ZSWAP_MAX_LEN (PGSIZE * 3 / 4)
+
+/* 압축 swap 캐시에 보관된 페이지 하나.
+ * 모든 바이트가 한 워드의 반복이면 arena 대신 FILL 하나만 둔다. */
+struct zswap_entry {
+	struct list_elem elem;  /* lru 원소 */
+	struct page *page;      /* 이 내용의 주인 페이지 */
+	size_t chunk;           /* arena 안의 첫 chunk 번호 */
+	size_t len;             /* 압축된 길이, same-filled면 0 */
+	uint64_t fill;          /* same-filled 페이지의 반복 워드 */
+};
+
+bool vm_zswap;
+
+/* arena와 그 chunk 사용 여부 */
+static uint8_t *arena;
+static struct bitmap *arena_map;
+
+/* 오래된 순서로 놓인 entry. arena가 차면 앞에서부터 디스크로 내린다. */
+static struct list lru;
+
+/* 압축, 해제에 쓰는 작업 버퍼 */
+static uint8_t *zbuf;
+static uint8_t *spill_buf;
+
+/* 위의 모든 상태와 entry를 보호한다. */
+static struct lock zswap_lock;
+
+/* 통계 */
+static long long store_cnt;     /* 캐시에 넣은 페이지 */
+static long long same_cnt;      /* 그중 same-filled 페이지 */
+static long long reject_cnt;    /* 잘 압축되지 않아 디스크로 보낸 페이지 */
+static long long hit_cnt;       /* 캐시에서 읽어 온 swap-in */
+static long long miss_cnt;      /* 디스크에서 읽어 온 swap-in */
+static long long spill_cnt;     /* arena가 차서 디스크로 내린 entry */
+static long long bytes_in;      /* 캐시에 넣은 원래 크기의 합 */
+static long long bytes_out;     /* 그 압축된 크기의 합 */
+
+static bool zswap_spill (struct zswap_entry *e);
+
+/* --- LZ 압축 ---
+ * LZ4와 비슷한 바이트 단위 형식이다. 각 sequence는
+ *   token (상위 4비트: literal 길이, 하위 4비트: match 길이 - 4)
+ *   [literal 길이 확장] literal [offset 2바이트] [match 길이 확장]
+ * 으로 이루어지고, 길이가 15 이상이면 255 미만의 바이트가 나올 때까지
+ * 확장 바이트를 더한다. 마지막 sequence는 literal만 있다. */
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 4
+
+static uint16_t lz_table[1 << LZ_HASH_BITS];
+
+static inline uint32_t
+lz_read32 (const uint8_t *p) {
+	uint32_t v;
+	memcpy (&v, p, sizeof v);
+	return v;
+}
+
+static inline unsigned
+lz_hash (uint32_t v) {
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* 15를 넘는 길이의 나머지 N을 확장 바이트로 쓴다. */
+static bool
+lz_put_ext (uint8_t **opp, uint8_t *op_end, size_t n) {
+	uint8_t *op = *opp;
+
+	for (; n >= 255; n -= 255) {
+		if (op >= op_end)
+			return false;
+		*op++ = 255;
+	}
+	if (op >= op_end)
+		return false;
+	*op++ = n;
+	*opp = op;
+	return true;
+}
+
+/* sequence 하나를 쓴다. LAST면 offset과 match 없이 literal만 쓴다. */
+static bool
+lz_emit (uint8_t **opp, uint8_t *op_end, const uint8_t *lit, size_t lit_len,
+		size_t offset, size_t match_len, bool last) {
+	uint8_t *op = *opp;
+	uint8_t *token;
+
+	if (op >= op_end)
+		return false;
+	token = op++;
+	*token = (lit_len < 15 ? lit_len : 15) << 4;
+	if (lit_len >= 15 && !lz_put_ext (&op, op_end, lit_len - 15))
+		return false;
+	if ((size_t) (op_end - op) < lit_len)
+		return false;
+	memcpy (op, lit, lit_len);
+	op += lit_len;
+
+	if (!last) {
+		if (op_end - op < 2)
+			return false;
+		*op++ = offset & 0xff;
+		*op++ = offset >> 8;
+		*token |= match_len < 15 ? match_len : 15;
+		if (match_len >= 15 && !lz_put_ext (&op, op_end, match_len - 15))
+			return false;
+	}
+	*opp = op;
+	return true;
+}
+
+/* SRC의 LEN바이트를 DST에 압축하고 길이를 반환한다.
+ * DST_MAX 안에 들어가지 않으면 0을 반환한다. */
+static size_t
+lz_compress (const uint8_t *src, size_t len, uint8_t *dst, size_t dst_max) {
+	const uint8_t *ip = src, *anchor = src, *end = src + len;
+	uint8_t *op = dst, *op_end = dst + dst_max;
+
+	memset (lz_table, 0, sizeof lz_table);
+	while (ip + LZ_MIN_MATCH <= end) {
+		uint32_t seq = lz_read32 (ip);
+		unsigned h = lz_hash (seq);
+		const uint8_t *ref = src + lz_table[h];
+
+		lz_table[h] = ip - src;
+		if (ref >= ip || lz_read32 (ref) != seq) {
+			ip++;
+			continue;
+		}
+
+		const uint8_t *mp = ip + LZ_MIN_MATCH, *rp = ref + LZ_MIN_MATCH;
+		while (mp < end && *mp == *rp)
+			mp++, rp++;
+		if (!lz_emit (&op, op_end, anchor, ip - anchor, ip - ref,
+					mp - ip - LZ_MIN_MATCH, false))
+			return 0;
+		ip = anchor = mp;
+	}
+	if (!lz_emit (&op, op_end, anchor, end - anchor, 0, 0, true))
+		return 0;
+	return op - dst;
+}
+
+/* 확장 바이트를 읽어 길이 N에 더한다. */
+static bool
+lz_get_ext (const uint8_t **ipp, const uint8_t *end, size_t *n) {
+	const uint8_t *ip = *ipp;
+	uint8_t b;
+
+	do {
+		if (ip >= end)
+			return false;
+		b = *ip++;
+		*n += b;
+	} while (b == 255);
+	*ipp = ip;
+	return true;
+}
+
+/* SRC의 LEN바이트를 풀어 DST를 정확히 DST_LEN바이트로 채운다. */
+static bool
+lz_decompress (const uint8_t *src, size_t len, uint8_t *dst, size_t dst_len) {
+	const uint8_t *ip = src, *end = src + len;
+	uint8_t *op = dst, *op_end = dst + dst_len;
+
+	while (ip < end) {
+		unsigned token = *ip++;
+		size_t lit = token >> 4;
+
+		if (lit == 15 && !lz_get_ext (&ip, end, &lit))
+			return false;
+		if ((size_t) (end - ip) < lit || (size_t) (op_end - op) < lit)
+			return false;
+		memcpy (op, ip, lit);
+		op += lit;
+		ip += lit;
+		if (ip == end)
+			break;
+
+		if (end - ip < 2)
+			return false;
+		size_t offset = ip[0] | ip[1] << 8;
+		size_t match = token & 15;
+		ip += 2;
+		if (match == 15 && !lz_get_ext (&ip, end, &match))
+			return false;
+		match += LZ_MIN_MATCH;
+		if (offset == 0 || offset > (size_t) (op - dst)
+				|| (size_t) (op_end - op) < match)
+			return false;
+
+		/* 겹치는 match가 있으므로 한 바이트씩 복사한다. */
+		const uint8_t *ref = op - offset;
+		while (match-- > 0)
+			*op++ = *ref++;
+	}
+	return op == op_end;
+}
+
+/* --- 캐시 --- */
+
+/* Initializes the compressed swap cache. */
+void
+zswap_init (void) {
+	arena = palloc_get_multiple (PAL_ASSERT, ZSWAP_ARENA_PAGES);
+	arena_map = bitmap_create (ZSWAP_CHUNK_CNT);
+	if (arena_map == NULL)
+		PANIC ("zswap_init: cannot allocate arena map");
+	zbuf = palloc_get_page (PAL_ASSERT);
+	spill_buf = palloc_get_page (PAL_ASSERT);
+	list_init (&lru);
+	lock_init (&zswap_lock);
+}
+
+/* KVA의 모든 워드가 같으면 그 값을 FILL에 담고 true를 반환한다. */
+static bool
+zswap_same_filled (const void *kva, uint64_t *fill) {
+	const uint64_t *word = kva;
+
+	for (size_t i = 1; i < PGSIZE / sizeof *word; i++)
+		if (word[i] != word[0])
+			return false;
+	*fill = word[0];
+	return true;
+}
+
+/* LEN바이트를 담을 연속된 chunk를 arena에서 잡는다. 자리가 없으면
+ * 오래된 entry부터 디스크로 내려 가며 다시 찾는다. */
+static size_t
+zswap_alloc (size_t len) {
+	size_t cnt = DIV_ROUND_UP (len, ZSWAP_CHUNK);
+
+	for (;;) {
+		size_t chunk = bitmap_scan_and_flip (arena_map, 0, cnt, false);
+		if (chunk != BITMAP_ERROR)
+			return chunk;
+
+		/* same-filled entry는 arena를 쓰지 않으므로 내려도 소용없다. */
+		struct zswap_entry *victim = NULL;
+		for (struct list_elem *e = list_begin (&lru); e != list_end (&lru);
+				e = list_next (e)) {
+			struct zswap_entry *entry = list_entry (e, struct zswap_entry, elem);
+			if (entry->len != 0) {
+				victim = entry;
+				break;
+			}
+		}
+		if (victim == NULL || !zswap_spill (victim))
+			return BITMAP_ERROR;
+	}
+}
+
+/* E의 내용을 KVA에 풀어 쓴다. */
+static void
+zswap_decode (struct zswap_entry *e, void *kva) {
+	if (e->len == 0) {
+		uint64_t *word = kva;
+		for (size_t i = 0; i < PGSIZE / sizeof *word; i++)
+			word[i] = e->fill;
+	} else if (!lz_decompress (arena + e->chunk * ZSWAP_CHUNK, e->len,
+				kva, PGSIZE))
+		PANIC ("zswap: corrupted entry for page %p", e->page->va);
+}
+
+/* E를 캐시에서 지운다. */
+static void
+zswap_remove (struct zswap_entry *e) {
+	if (e->len != 0)
+		bitmap_set_multiple (arena_map, e->chunk,
+				DIV_ROUND_UP (e->len, ZSWAP_CHUNK), false);
+	list_remove (&e->elem);
+	e->page->anon.zswap = NULL;
+	free (e);
+}
+
+/* E를 주인 페이지의 swap 슬롯에 쓰고 캐시에서 지운다.
+ * swap 디스크가 가득 차 쓸 수 없으면 false를 반환한다. */
+static bool
+zswap_spill (struct zswap_entry *e) {
+	zswap_decode (e, spill_buf);
+	if (!anon_spill (e->page, spill_buf))
+		return false;
+	zswap_remove (e);
+	spill_cnt++;
+	return true;
+}
+
+/* swap-out 되는 PAGE의 내용 KVA를 압축해 캐시에 넣는다.
+ * 잘 압축되지 않거나 자리를 만들 수 없으면 false를 반환하고,
+ * 호출자는 평소처럼 디스크에 쓴다. */
+bool
+zswap_store (struct page *page, const void *kva) {
+	struct zswap_entry *e = malloc (sizeof *e);
+	if (e == NULL)
+		return false;
+	e->page = page;
+	e->len = 0;
+
+	lock_acquire (&zswap_lock);
+	if (zswap_same_filled (kva, &e->fill))
+		same_cnt++;
+	else {
+		size_t len = lz_compress (kva, PGSIZE, zbuf, ZSWAP_MAX_LEN);
+		size_t chunk = len != 0 ? zswap_alloc (len) : BITMAP_ERROR;
+		if (chunk == BITMAP_ERROR) {
+			reject_cnt++;
+			lock_release (&zswap_lock);
+			free (e);
+			return false;
+		}
+		memcpy (arena + chunk * ZSWAP_CHUNK, zbuf, len);
+		e->chunk = chunk;
+		e->len = len;
+	}
+	list_push_back (&lru, &e->elem);
+	page->anon.zswap = e;
+	store_cnt++;
+	bytes_in += PGSIZE;
+	bytes_out += e->len != 0 ? e->len : sizeof e->fill;
+	lock_release (&zswap_lock);
+	return true;
+}
+
+/* PAGE가 캐시에 있으면 KVA에 풀어 쓰고 캐시에서 지운 뒤 true를 반환한다.
+ * 없으면 (이미 디스크로 내려갔으면) false를 반환한다. */
+bool
+zswap_load (struct page *page, void *kva) {
+	bool hit;
+
+	lock_acquire (&zswap_lock);
+	hit = page->anon.zswap != NULL;
+	if (hit) {
+		zswap_decode (page->anon.zswap, kva);
+		zswap_remove (page->anon.zswap);
+		hit_cnt++;
+	} else
+		miss_cnt++;
+	lock_release (&zswap_lock);
+	return hit;
+}
+
+/* 캐시에 있는 PAGE의 내용을 KVA로 복사한다. entry는 그대로 둔다.
+ * fork가 자식 몫의 사본을 만들 때 쓴다. */
+void
+zswap_copy (struct page *page, void *kva) {
+	lock_acquire (&zswap_lock);
+	ASSERT (page->anon.zswap != NULL);
+	zswap_decode (page->anon.zswap, kva);
+	lock_release (&zswap_lock);
+}
+
+/* PAGE가 캐시에 있으면 지운다. */
+void
+zswap_free (struct page *page) {
+	lock_acquire (&zswap_lock);
+	if (page->anon.zswap != NULL)
+		zswap_remove (page->anon.zswap);
+	lock_release (&zswap_lock);
+}
+
+/* Prints compressed swap cache statistics. */
+void
+zswap_print_stats (void) {
+	long long ratio = bytes_out != 0 ? bytes_in * 100 / bytes_out : 0;
+	long long lookups = hit_cnt + miss_cnt;
+
+	printf ("Zswap: %lld stores (%lld same-filled), %lld rejected, "
+			"%lld spilled\n", store_cnt, same_cnt, reject_cnt, spill_cnt);
+	printf ("Zswap: %lld hits, %lld misses (%lld%% hit rate), "
+			"compression ratio %lld.%02lld\n", hit_cnt, miss_cnt,
+			lookups != 0 ? hit_cnt * 100 / lookups : 0,
+			ratio / 100, ratio % 100);
+}